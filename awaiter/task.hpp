@@ -3,8 +3,11 @@
 #include<utils/generator_result.hpp>  
 #include<utils/expected.hpp>  
 #include<utils/uninitialized.hpp>  // 未初始化内存
-#if ZH_ASYNC_PERF
-#include<utils/perf.hpp>  // 包含性能测量
+#if ZH_ASYNC_PERF || ZH_ASYNC_FRAMESTAT
+#include<utils/perf.hpp>  // 包含性能测量和协程帧统计
+#endif
+#if ZH_ASYNC_ALLOC
+#include<generic/allocator.hpp>  // 协程帧分配器
 #endif
 #include<awaiter/concepts.hpp>  // 协程概念
 #include<awaiter/details/previous_awaiter.hpp>  // 包含之前的awaiter相关实现
@@ -22,15 +25,18 @@ namespace zh_async
 // 任务等待器的内存分配状态
 struct TaskAwaiterAllocState {
     std::pmr::memory_resource *mLastAllocator;  // 保存上一个内存分配器
+    std::size_t mLastArenaDepth;  // 保存上一层的 co_arena 嵌套层数
 
     // 将当前分配器压入栈中
     void push() noexcept {
         mLastAllocator = currentAllocator;  // 记录当前分配器
+        mLastArenaDepth = arenaDepth;
     }
 
     // 弹出栈中的分配器
     void pop() noexcept {
         currentAllocator = mLastAllocator;  // 恢复到上一个分配器
+        arenaDepth = mLastArenaDepth;
     }
 };
 #endif
@@ -396,8 +402,52 @@ private:
 struct TaskPromiseLocal { 
     // 取消命令的令牌
     void *mCancelToken = nullptr;  
+#if ZH_ASYNC_ALLOC
+    // 任务树绑定的分配器（见 co_with_allocator），为空表示跟随 currentAllocator
+    std::pmr::memory_resource *mAllocator = nullptr;
+    // 任务树之外的分配器，树里的协程挂起回到事件循环时换回这个
+    std::pmr::memory_resource *mOuterAllocator = nullptr;
+    // 任务树之外的 co_arena 嵌套层数，和 mOuterAllocator 一起换回
+    std::size_t mOuterArenaDepth = 0;
+#endif
 };
 
+#if ZH_ASYNC_ALLOC
+/*
+    包装 I/O、计时器等非 Task 的等待
+    TaskAwaiter 只在 Task 之间切换时保存和恢复 currentAllocator，
+    协程在 I/O 上挂起后由事件循环直接恢复，不经过调用者，所以在这里补上：
+    挂起前换回任务树外的分配器，免得事件循环里的其他协程用到它；恢复后再换回任务树自己的分配器
+*/
+template <class A>
+struct TaskAllocatorAwaiter {
+    A mAwaiter;
+    TaskPromiseLocal const *mLocals;
+    std::size_t mArenaDepth = 0;
+
+    bool await_ready() {
+        return mAwaiter.await_ready();
+    }
+
+    template <class P>
+    decltype(auto) await_suspend(std::coroutine_handle<P> coroutine) {
+        if (mLocals->mAllocator) {
+            currentAllocator = mLocals->mOuterAllocator;
+            mArenaDepth = std::exchange(arenaDepth, mLocals->mOuterArenaDepth);
+        }
+        return mAwaiter.await_suspend(coroutine);
+    }
+
+    decltype(auto) await_resume() {
+        if (mLocals->mAllocator) {
+            currentAllocator = mLocals->mAllocator;
+            arenaDepth = mArenaDepth;
+        }
+        return mAwaiter.await_resume();
+    }
+};
+#endif
+
 /*
     promise_type 不是 C++ 的一个具体类，而是一个“契约”或“接口规范”，
     是协程的“内部控制器”或“灵魂”。它决定了协程从创建、执行、暂停、返回到销毁的整个生命周期的行为。
@@ -424,15 +474,27 @@ struct TaskPromiseCommonBase {
 
     TaskPromiseCommonBase() = default;  
     TaskPromiseCommonBase(TaskPromiseCommonBase &&) = delete;  
-#if ZH_ASYNC_ALLOC
+#if ZH_ASYNC_ALLOC || ZH_ASYNC_FRAMESTAT
     // 重载 new 操作符，支持自定义内存资源
     void *operator new(std::size_t size) {
-        return std::pmr::get_default_resource()->allocate(size);  // 使用默认内存资源分配内存
+#if ZH_ASYNC_ALLOC
+        void *frame = std::pmr::get_default_resource()->allocate(size);  // 使用默认内存资源分配内存
+#else
+        void *frame = ::operator new(size);
+#endif
+#if ZH_ASYNC_FRAMESTAT
+        FrameStat::onAllocate(frame, size);  // 记下帧地址和大小，构造 promise 时按帧地址归到对应的协程函数上
+#endif
+        return frame;
     }
 
     // 重载 delete 操作符
     void operator delete(void *ptr, std::size_t size) noexcept {
+#if ZH_ASYNC_ALLOC
         std::pmr::get_default_resource()->deallocate(ptr, size);  // 释放内存
+#else
+        ::operator delete(ptr, size);
+#endif
     }
 #endif
 };
@@ -457,6 +519,13 @@ struct TaskPromiseCommon : TaskPromiseCommonBase {
         return static_cast<TaskPromise const &>(*this); 
     }
 
+#if ZH_ASYNC_FRAMESTAT
+    // 所在协程帧的地址，即 operator new 返回的指针；只做地址换算，构造 promise 期间也可以调用
+    void *frameAddress() noexcept {
+        return std::coroutine_handle<TaskPromise>::from_promise(self()).address();
+    }
+#endif
+
     void unhandled_exception() noexcept {
         /*
             作为基类 TaskPromiseCommon 并不知道mAwaiter是什么
@@ -669,12 +738,37 @@ struct TaskPromiseTransforms {
         return self().await_transform(u(self())); 
     }
 
+#if ZH_ASYNC_ALLOC
+    // 非 Task 的可等待对象包一层，让任务树绑定的分配器跨过挂起点（Task 本身有 promise_type，不包装）
+    template <class U>
+        requires(!std::invocable<U, TaskPromise &> &&
+                 !requires { typename std::remove_cvref_t<U>::promise_type; } &&
+                 Awaitable<std::remove_cvref_t<U>>)
+    auto await_transform(U &&u) {
+        if constexpr (Awaiter<std::remove_cvref_t<U>>) {
+            return TaskAllocatorAwaiter<U &&>{std::forward<U>(u), &self().mLocals};
+        } else {
+            using A = decltype(std::forward<U>(u).operator co_await());
+            return TaskAllocatorAwaiter<A>{std::forward<U>(u).operator co_await(),
+                                           &self().mLocals};
+        }
+    }
+
+    template <class U>
+        requires(!std::invocable<U, TaskPromise &> &&
+                 (requires { typename std::remove_cvref_t<U>::promise_type; } ||
+                  !Awaitable<std::remove_cvref_t<U>>))
+    U &&await_transform(U &&u) noexcept {
+        return std::forward<U>(u);
+    }
+#else
     // 用于处理不可调用的类型 U，直接转发出去
     template <class U>
         requires(!std::invocable<U, TaskPromise &>)
     U &&await_transform(U &&u) noexcept {
         return std::forward<U>(u);   
     }
+#endif
 };
 
 // 定义 TaskPromise 的实现
@@ -742,9 +836,20 @@ struct TaskPromise : TaskPromiseImpl<TaskPromise<T>, T> {
 
 #if ZH_ASYNC_PERF
     Perf mPerf;  // 性能追踪
-    // 使用构造函数记录对象创建时间
+#endif
+#if ZH_ASYNC_FRAMESTAT
+    FrameStat mFrameStat;  // 协程帧统计
+#endif
+#if ZH_ASYNC_PERF || ZH_ASYNC_FRAMESTAT
+    // 默认参数在协程函数里求值，记录的就是协程函数的位置
     TaskPromise(std::source_location loc = std::source_location::current())
+# if ZH_ASYNC_PERF && ZH_ASYNC_FRAMESTAT
+        : mPerf(loc), mFrameStat(this->frameAddress(), loc) {}
+# elif ZH_ASYNC_PERF
         : mPerf(loc) {}  // 初始化性能追踪
+# else
+        : mFrameStat(this->frameAddress(), loc) {}
+# endif
 #endif
 };
 
@@ -755,7 +860,9 @@ struct TaskPromise<void> : TaskPromiseImpl<TaskPromise<void>, void>
         mAwaiter->returnVoid();
     }
 
+#if !(ZH_ASYNC_PERF || ZH_ASYNC_FRAMESTAT)
     TaskPromise() = default;
+#endif
     TaskPromise(TaskPromise &&) = delete;
 
     TaskAwaiter<void> *mAwaiter{};
@@ -763,9 +870,20 @@ struct TaskPromise<void> : TaskPromiseImpl<TaskPromise<void>, void>
 
 #if ZH_ASYNC_PERF
     Perf mPerf;  // 性能追踪
-    // 使用构造函数记录对象创建时间
+#endif
+#if ZH_ASYNC_FRAMESTAT
+    FrameStat mFrameStat;  // 协程帧统计
+#endif
+#if ZH_ASYNC_PERF || ZH_ASYNC_FRAMESTAT
+    // 默认参数在协程函数里求值，记录的就是协程函数的位置
     TaskPromise(std::source_location loc = std::source_location::current())
+# if ZH_ASYNC_PERF && ZH_ASYNC_FRAMESTAT
+        : mPerf(loc), mFrameStat(this->frameAddress(), loc) {}
+# elif ZH_ASYNC_PERF
         : mPerf(loc) {}  // 初始化性能追踪
+# else
+        : mFrameStat(this->frameAddress(), loc) {}
+# endif
 #endif
 };
 
@@ -801,9 +919,20 @@ struct TaskPromise<GeneratorResult<T, E>> : TaskPromiseImpl<TaskPromise<Generato
 
 #if ZH_ASYNC_PERF
     Perf mPerf;  // 性能追踪
-
+#endif
+#if ZH_ASYNC_FRAMESTAT
+    FrameStat mFrameStat;  // 协程帧统计
+#endif
+#if ZH_ASYNC_PERF || ZH_ASYNC_FRAMESTAT
+    // 默认参数在协程函数里求值，记录的就是协程函数的位置
     TaskPromise(std::source_location loc = std::source_location::current())
+# if ZH_ASYNC_PERF && ZH_ASYNC_FRAMESTAT
+        : mPerf(loc), mFrameStat(this->frameAddress(), loc) {}
+# elif ZH_ASYNC_PERF
         : mPerf(loc) {}  // 初始化性能追踪
+# else
+        : mFrameStat(this->frameAddress(), loc) {}
+# endif
 #endif
 };
 
@@ -830,11 +959,22 @@ struct TaskPromise<GeneratorResult<T, void>>
     TaskAwaiter<GeneratorResult<T, void>> *mAwaiter{};  
     TaskPromiseLocal mLocals{}; 
 
-#if CO_ASYNC_PERF
+#if ZH_ASYNC_PERF
     Perf mPerf;  // 性能追踪
-
+#endif
+#if ZH_ASYNC_FRAMESTAT
+    FrameStat mFrameStat;  // 协程帧统计
+#endif
+#if ZH_ASYNC_PERF || ZH_ASYNC_FRAMESTAT
+    // 默认参数在协程函数里求值，记录的就是协程函数的位置
     TaskPromise(std::source_location loc = std::source_location::current())
+# if ZH_ASYNC_PERF && ZH_ASYNC_FRAMESTAT
+        : mPerf(loc), mFrameStat(this->frameAddress(), loc) {}
+# elif ZH_ASYNC_PERF
         : mPerf(loc) {}  // 初始化性能追踪
+# else
+        : mFrameStat(this->frameAddress(), loc) {}
+# endif
 #endif
 };
 
@@ -848,6 +988,64 @@ struct CustomPromise : TaskPromise<T> {
     }
 };
 
+#if ZH_ASYNC_ALLOC
+// 在当前协程上登记任务树的分配器，之后 co_await 的 Task 通过 mLocals 继承它
+struct SetTaskAllocator {
+    std::pmr::memory_resource *mAllocator;
+    bool mArena = false;  // 由 co_arena 绑定，树里不允许 co_spawn
+
+    template <class P>
+    std::suspend_never operator()(P &promise) const noexcept {
+        // 嵌套绑定时，树外的分配器仍然是最外层的那个
+        if (!promise.mLocals.mAllocator) {
+            promise.mLocals.mOuterAllocator = currentAllocator;
+            promise.mLocals.mOuterArenaDepth = arenaDepth;
+        }
+        promise.mLocals.mAllocator = mAllocator;
+        currentAllocator = mAllocator;
+        if (mArena) {
+            ++arenaDepth;
+        }
+        return {};
+    }
+};
+
+/*
+    让 task 及其 co_await 的所有子任务都从 allocator 分配（协程帧、String、ByteBuffer 等默认资源上的分配）
+    即使中途在 I/O 上挂起、之后由事件循环恢复也不会丢失，结束后 currentAllocator 恢复原样
+    allocator 必须活到 task 结束，并且返回值不能持有从 allocator 分配的内存
+*/
+template <class T>
+inline Task<T> co_with_allocator(std::pmr::memory_resource *allocator,
+                                 Task<T> task) {
+    co_await SetTaskAllocator{allocator};
+    co_return co_await std::move(task);
+}
+
+/*
+    为一次请求建立独立的 ArenaResource，调用 f(args...) 得到的任务树都从它分配，请求结束时整块释放，例如：
+        co_spawn(co_arena(handle_connection, std::move(sock)));
+    f 在绑定 arena 之后才被调用，根任务的协程帧也在 arena 上，不会出现树外分配、树内释放的情况
+    返回值不能带出 arena 里的内存，所以 f 只能返回 Task<> 或 Task<Expected<>>
+    arena 里创建的协程不能 co_spawn 出去（会比 arena 活得久），见 check_detach_allowed
+*/
+template <class F, class... Args>
+    requires(std::is_same_v<std::invoke_result_t<F, Args...>, Task<>> ||
+             std::is_same_v<std::invoke_result_t<F, Args...>, Task<Expected<>>>)
+inline std::invoke_result_t<F, Args...> co_arena(std::size_t blockSize, F f,
+                                                 Args... args) {
+    ArenaResource arena(blockSize);
+    co_await SetTaskAllocator{&arena, true};
+    co_return co_await std::invoke(std::move(f), std::move(args)...);
+}
+
+template <class F, class... Args>
+    requires(!std::is_integral_v<F>)
+inline auto co_arena(F f, Args... args) {
+    return co_arena(std::size_t(4096), std::move(f), std::move(args)...);
+}
+#endif
+
 // 绑定可调用对象并返回
 template <class F, class... Args>
     requires(Awaitable<std::invoke_result_t<F, Args...>>)
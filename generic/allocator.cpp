@@ -1,34 +1,303 @@
 
 #include<std.hpp>
 #include<generic/allocator.hpp>
+#include<utils/cacheline.hpp>
 
 namespace zh_async
 {
+namespace
+{
+    struct FramePool;
+
+    /*
+        紧挨着返回地址的最后一个字是块的来源标记，池的块头和 DefaultResource 的资源头都放在同一个位置，
+        释放时只看这个字就能区分，不依赖块头里其他字段的取值范围
+    */
+    enum class BlockTag : std::uint32_t
+    {
+        Pool = 0x706f6f6c,      // 协程帧池的块
+        Resource = 0x72736f75,  // 资源头，前面记着分配它的资源
+    };
+
+    // 每个池内块前面的块头，16 字节，保证返回给调用者的地址仍按 16 字节对齐
+    struct alignas(16) FrameBlock
+    {
+        FramePool *mOwner;      // 为空表示不属于任何池（线程退出后的分配）
+        std::uint32_t mClass;   // 所在的大小档位
+        BlockTag mTag;          // 总是 BlockTag::Pool
+    };
+
+    // 空闲块复用负载的第一个字作为链表指针
+    struct FreeLink
+    {
+        FrameBlock *mNext;
+    };
+
+    inline constexpr std::size_t kFrameClassSize = 64;
+    inline constexpr std::size_t kFrameClasses = 32;
+    inline constexpr std::size_t kFrameMaxSize = kFrameClassSize * kFrameClasses;
+
+    inline FreeLink *freeLink(FrameBlock *block) noexcept
+    { return reinterpret_cast<FreeLink *>(block + 1); }
+
+    inline FrameBlock *newFrameBlock(FramePool *owner, std::size_t cls)
+    {
+        auto block = static_cast<FrameBlock *>(
+            ::operator new(sizeof(FrameBlock) + (cls + 1) * kFrameClassSize));
+        block->mOwner = owner;
+        block->mClass = static_cast<std::uint32_t>(cls);
+        block->mTag = BlockTag::Pool;
+        return block;
+    }
+
+    struct FramePool
+    {
+        FrameBlock *mFree[kFrameClasses]{};
+        // 其他线程释放的块，独占缓存行，避免和所属线程的本地链表伪共享
+        alignas(hardware_destructive_interference_size)
+        std::atomic<FrameBlock *> mRemote{nullptr};
+
+        void pushLocal(FrameBlock *block) noexcept
+        {
+            freeLink(block)->mNext = mFree[block->mClass];
+            mFree[block->mClass] = block;
+        }
+
+        // 任意线程调用
+        void pushRemote(FrameBlock *block) noexcept
+        {
+            FrameBlock *head = mRemote.load(std::memory_order_relaxed);
+            do{
+                freeLink(block)->mNext = head;
+            }while(!mRemote.compare_exchange_weak(head, block,
+                        std::memory_order_release, std::memory_order_relaxed));
+        }
+
+        // 把远程释放的块整体取回到本地链表
+        bool drainRemote() noexcept
+        {
+            FrameBlock *block = mRemote.exchange(nullptr, std::memory_order_acquire);
+            if(!block)
+                return false;
+            while(block)
+            {
+                FrameBlock *next = freeLink(block)->mNext;
+                pushLocal(block);
+                block = next;
+            }
+            return true;
+        }
+
+        FrameBlock *allocate(std::size_t cls)
+        {
+            if(!mFree[cls])[[unlikely]]
+            {
+                if(!drainRemote() || !mFree[cls])
+                    return newFrameBlock(this, cls);
+            }
+            FrameBlock *block = mFree[cls];
+            mFree[cls] = freeLink(block)->mNext;
+            return block;
+        }
+    };
+
+    // 已退出线程留下的池，还有块在外面时不能释放，交给新线程接管
+    std::mutex orphanMutex;
+    std::vector<FramePool *> orphanPools;
+
+    // 平凡析构的线程局部变量在线程清理阶段仍然可以安全访问
+    thread_local FramePool *localPool = nullptr;
+    thread_local bool localPoolExited = false;
+
+    struct FramePoolOwner
+    {
+        FramePool *mPool = nullptr;
+
+        ~FramePoolOwner()
+        {
+            localPool = nullptr;
+            localPoolExited = true;
+            if(mPool)
+            {
+                std::lock_guard lock(orphanMutex);
+                orphanPools.push_back(mPool);
+            }
+        }
+    };
+
+    thread_local FramePoolOwner localPoolOwner;
+
+    FramePool *currentFramePool()
+    {
+        if(localPool)[[likely]]
+            return localPool;
+        if(localPoolExited)
+            return nullptr;
+        FramePool *pool = nullptr;
+        {
+            std::lock_guard lock(orphanMutex);
+            if(!orphanPools.empty())
+            {
+                pool = orphanPools.back();
+                orphanPools.pop_back();
+            }
+        }
+        if(!pool)
+            pool = new FramePool;
+        localPoolOwner.mPool = pool;
+        localPool = pool;
+        return pool;
+    }
+
+    struct FramePoolResource : std::pmr::memory_resource
+    {
+        void *do_allocate(size_t size, size_t align) override
+        {
+            if(size > kFrameMaxSize || align > alignof(FrameBlock))[[unlikely]]
+                return ::operator new(size, std::align_val_t(align));
+            std::size_t cls = size ? (size - 1) / kFrameClassSize : 0;
+            FramePool *pool = currentFramePool();
+            FrameBlock *block = pool ? pool->allocate(cls) : newFrameBlock(nullptr, cls);
+            return block + 1;
+        }
+
+        void do_deallocate(void *p, size_t size, size_t align) override
+        {
+            if(size > kFrameMaxSize || align > alignof(FrameBlock))[[unlikely]]
+            {
+                ::operator delete(p, std::align_val_t(align));
+                return;
+            }
+            FrameBlock *block = static_cast<FrameBlock *>(p) - 1;
+            if(!block->mOwner)[[unlikely]]
+                ::operator delete(block);
+            else if(block->mOwner == localPool)[[likely]]
+                block->mOwner->pushLocal(block);
+            else
+                block->mOwner->pushRemote(block);
+        }
+
+        bool do_is_equal(
+            std::pmr::memory_resource const &other) const noexcept override
+        { return this == &other; }
+    };
+}
+
+    std::pmr::memory_resource *frame_pool_resource() noexcept
+    {
+        static FramePoolResource resource;
+        return &resource;
+    }
+
+    void *ArenaResource::do_allocate(size_t size, size_t align)
+    {
+        char *p = reinterpret_cast<char *>(
+            (reinterpret_cast<std::uintptr_t>(mCurrent) + align - 1) & ~(std::uintptr_t(align) - 1));
+        if(!mCurrent || p + size > mEnd)[[unlikely]]
+        {
+            std::size_t need = sizeof(Chunk) + size + align;
+            std::size_t chunkSize = std::max(mNextSize, need);
+            auto chunk = static_cast<Chunk *>(mUpstream->allocate(chunkSize, alignof(Chunk)));
+            chunk->mPrev = mChunks;
+            chunk->mSize = chunkSize;
+            mChunks = chunk;
+            mCurrent = reinterpret_cast<char *>(chunk + 1);
+            mEnd = reinterpret_cast<char *>(chunk) + chunkSize;
+            mNextSize = chunkSize * 2;
+            p = reinterpret_cast<char *>(
+                (reinterpret_cast<std::uintptr_t>(mCurrent) + align - 1) & ~(std::uintptr_t(align) - 1));
+        }
+        mCurrent = p + size;
+        return p;
+    }
+
+    void ArenaResource::do_deallocate(void *p, size_t size, size_t)
+    {
+        // 只回收最后一次分配，其余等 release 时统一释放
+        if(static_cast<char *>(p) + size == mCurrent)
+            mCurrent = static_cast<char *>(p);
+    }
+
+    void ArenaResource::release() noexcept
+    {
+        while(mChunks)
+        {
+            Chunk *prev = mChunks->mPrev;
+            mUpstream->deallocate(mChunks, mChunks->mSize, alignof(Chunk));
+            mChunks = prev;
+        }
+        mCurrent = mEnd = nullptr;
+    }
+
     /*
         为 currentAllocator 初始化
         new_delete_resource()返回一个memory_resource对象，使用全局的 new 和 delete 来操作内存
-        通过将 currentAllocator 初始化为 new_delete_resource() 确保了zh_async中的所有内存分配都使用默认的new和delete
+        开启 ZH_ASYNC_ALLOC 时改为协程帧池，大量短命的协程帧不再每次都走 malloc
         使用 thread_pool 意味着 currentAllocator 对于每个线程是独立的，这允许每个线程使用不同的内存分配策略
     */
     thread_local std::pmr::memory_resource *currentAllocator =
+#if ZH_ASYNC_ALLOC
+    frame_pool_resource();
+#else
     std::pmr::new_delete_resource();
+#endif
+
+#if ZH_ASYNC_ALLOC
+    thread_local std::size_t arenaDepth = 0;
+#endif
 
 #if ZH_ASYNC_ALLOC
 namespace
 {
+    /*
+        经过树绑定的分配器（co_with_allocator / co_arena）分配的块，前面记下分配它的资源，释放时还给同一个资源
+        协程帧、String 等经常在和分配时不同的 currentAllocator 下被释放（例如请求内分配、请求外销毁），
+        不能直接交给释放时的 currentAllocator
+        从协程帧池分配的块（绝大多数）不需要这个头：池的块头已经记下所属的池，任何线程、任何 currentAllocator 下都能正确释放
+        释放时靠紧挨着 p 的 BlockTag 区分两者
+    */
+    struct alignas(16) ResourceHeader
+    {
+        std::pmr::memory_resource *mResource;
+        std::uint32_t mPadding;
+        BlockTag mTag;          // 总是 BlockTag::Resource
+    };
+    static_assert(sizeof(ResourceHeader) == sizeof(FrameBlock));
+    static_assert(offsetof(ResourceHeader, mTag) == offsetof(FrameBlock, mTag));
+    static_assert(offsetof(FrameBlock, mTag) + sizeof(BlockTag) == sizeof(FrameBlock));
+
+    inline BlockTag blockTag(void *p) noexcept
+    { return reinterpret_cast<BlockTag *>(p)[-1]; }
+
     inline struct DefaultResource : std::pmr::memory_resource
     {
         void *do_allocate(size_t size, size_t align) override {
-        return currentAllocator->allocate(size, align);
+        std::pmr::memory_resource *resource = currentAllocator;
+        if(resource == frame_pool_resource() && size <= kFrameMaxSize &&
+           align <= alignof(FrameBlock))[[likely]]
+            return resource->allocate(size, align);
+        std::size_t offset = std::max(align, sizeof(ResourceHeader));
+        char *p = static_cast<char *>(resource->allocate(size + offset, offset)) + offset;
+        auto header = reinterpret_cast<ResourceHeader *>(p) - 1;
+        header->mResource = resource;
+        header->mTag = BlockTag::Resource;
+        return p;
     }
 
     void do_deallocate(void *p, size_t size, size_t align) override {
-        return currentAllocator->deallocate(p, size, align);
+        if(blockTag(p) == BlockTag::Pool)[[likely]]
+        {
+            frame_pool_resource()->deallocate(p, size, align);
+            return;
+        }
+        std::size_t offset = std::max(align, sizeof(ResourceHeader));
+        std::pmr::memory_resource *resource = (reinterpret_cast<ResourceHeader *>(p) - 1)->mResource;
+        resource->deallocate(static_cast<char *>(p) - offset, size + offset, offset);
     }
 
     bool do_is_equal(
         std::pmr::memory_resource const &other) const noexcept override {
-        return currentAllocator->is_equal(other);
+        return this == &other;
     }
 
     DefaultResource() noexcept {
@@ -40,4 +309,4 @@ namespace
 }
 #endif
     
-}
\ No newline at end of file
+}
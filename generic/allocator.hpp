@@ -17,11 +17,82 @@ namespace zh_async
     //currentAllocator 指向当前使用的内存资源
     extern thread_local std::pmr::memory_resource *currentAllocator;
 
+    /*
+        协程帧池：按 64 字节一档分级的线程本地空闲链表，分配和释放都不加锁
+        块头记录所属的线程池，在其他线程释放的块压入所属池的远程释放链表（无锁栈），
+        由所属线程在本地链表用完时一次性取回
+        线程退出后它的池交给之后新建的线程接管，池里的内存只会复用，不会还给系统
+        超过 2048 字节或对齐要求超过 16 字节的分配直接交给全局 new/delete
+        开启 ZH_ASYNC_ALLOC 时作为每个线程 currentAllocator 的初始值，Task 的协程帧默认从这里分配
+    */
+    std::pmr::memory_resource *frame_pool_resource() noexcept;
+
+    /*
+        单调递增（bump-pointer）的内存池，通常一个请求一个
+        分配只是移动指针，空间不够时向上游申请一块更大的（每次翻倍）
+        释放是空操作，只有最后一次分配被释放时才回退指针，嵌套协程帧这种后进先出的用法可以就地复用
+        所有内存在 release() 或析构时一次性还给上游，此时从这里分配的对象必须都已经销毁
+        不是线程安全的，同一时刻只能有一个线程从中分配
+        配合 co_with_allocator / co_arena 绑定到一棵任务树上
+    */
+    struct ArenaResource : std::pmr::memory_resource
+    {
+        explicit ArenaResource(std::size_t blockSize = 4096,
+                               std::pmr::memory_resource *upstream = std::pmr::new_delete_resource()) noexcept
+            : mNextSize(blockSize), mUpstream(upstream) {}
+
+        ArenaResource(ArenaResource &&) = delete;
+
+        ~ArenaResource() { release(); }
+
+        // 把所有块还给上游
+        void release() noexcept;
+
+    private:
+        struct Chunk
+        {
+            Chunk *mPrev;
+            std::size_t mSize;
+        };
+
+        Chunk *mChunks = nullptr;
+        char *mCurrent = nullptr;
+        char *mEnd = nullptr;
+        std::size_t mNextSize;
+        std::pmr::memory_resource *mUpstream;
+
+        void *do_allocate(size_t size, size_t align) override;
+        void do_deallocate(void *p, size_t size, size_t align) override;
+        bool do_is_equal(
+            std::pmr::memory_resource const &other) const noexcept override
+        { return this == &other; }
+    };
+
+#if ZH_ASYNC_ALLOC
+    /*
+        当前线程正在运行的 co_arena 任务树的嵌套层数，和 currentAllocator 在同样的地方保存和恢复：
+        co_arena 绑定 arena 时加一，任务树在 I/O 上挂起时换回树外的层数，恢复时再换回来
+    */
+    extern thread_local std::size_t arenaDepth;
+
+    /*
+        co_arena 的任务树里创建的协程帧都在 arena 上，请求结束时随 arena 一起释放，
+        co_spawn 出去脱离任务树的协程会比 arena 活得久，所以在 arena 里 co_spawn 直接报错
+        确实需要在请求里启动后台任务时，先用 ReplaceAllocator 换回 frame_pool_resource() 再创建任务
+    */
+    inline void check_detach_allowed()
+    {
+        if(arenaDepth)[[unlikely]]
+            throw std::logic_error("co_spawn inside co_arena: the task would outlive the arena");
+    }
+#endif
+
     /*
         当ReplaceAllocator对象被创建时，它会保存当前的currentAllocator，
         并用传入的allocator替代currentAllocator
         当ReplaceAllocator被销毁时，会恢复之前的currentAllocator。
         者允许在特定的作用域内使用自定义的内存分配策略
+        作用域内不再算作处在 co_arena 里，可以 co_spawn，由调用方保证换上的分配器活得足够久
     */
     struct ReplaceAllocator
     {
@@ -29,14 +100,27 @@ namespace zh_async
         {
             lastAllocator = currentAllocator;
             currentAllocator = allocator;
+#if ZH_ASYNC_ALLOC
+            lastArenaDepth = arenaDepth;
+            arenaDepth = 0;
+#endif
         }
 
         ReplaceAllocator(ReplaceAllocator &&) = delete;
 
-        ~ReplaceAllocator() { currentAllocator = lastAllocator; }
+        ~ReplaceAllocator()
+        {
+            currentAllocator = lastAllocator;
+#if ZH_ASYNC_ALLOC
+            arenaDepth = lastArenaDepth;
+#endif
+        }
 
     private:
         std::pmr::memory_resource *lastAllocator;
+#if ZH_ASYNC_ALLOC
+        std::size_t lastArenaDepth;
+#endif
     };
 
 }
\ No newline at end of file
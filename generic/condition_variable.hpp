@@ -3,62 +3,168 @@
 #include <awaiter/task.hpp>
 #include <generic/cancel.hpp>
 #include <generic/generic_io.hpp>
+#include <generic/io_context.hpp>
 #include <generic/timeout.hpp>
 #include <generic/when_any.hpp>
-#include <platform/futex.hpp>
 #include <utils/ilist.hpp>
+#include <utils/spin_mutex.hpp>
 
 namespace zh_async
 {
+    /*
+        用户态等待队列实现的条件变量，不经过 futex
+            等待者节点放在 wait() 的协程帧里，挂在侵入式链表上，并记下自己所属的 IOContext
+            notify 从链表中取出等待者，post 回它所属的 IOContext：
+                同一个 IOContext 上的协程互相唤醒只是一次本地队列入队，不发系统调用，也不提交 io_uring 操作
+                跨线程时才经 MSG_RING 或 eventfd 门铃叫醒目标线程
+            没有等待者时 notify 只读一次计数，不加锁
+        跨线程使用时，条件在检查之后、挂起之前被满足会丢失这次唤醒，
+            这时应使用带 pred 的 wait：pred 在等待队列的锁内、登记之后检查，为真时直接返回不挂起
+    */
     struct ConditionVariable
     {
+        using Mask = std::uint32_t;
+        static constexpr Mask kMaskAll = ~Mask(0);
+
     private:
-        FutexAtomic<std::uint32_t> mFutex{};
+        struct Waiter : IntrusiveList<Waiter>::NodeType
+        {
+            std::coroutine_handle<> mPrevious;
+            IOContext *mContext = nullptr;
+            Mask mMask = kMaskAll;
+            bool mQueued = false;   // 是否还在等待队列中
+            bool mCanceled = false;
+        };
 
-    public:
-        Task<Expected<>> wait()
+        SpinMutex mLock;
+        IntrusiveList<Waiter> mWaiters;
+        std::atomic<std::uint32_t> mNumWaiters{0};
+
+        template <class Pred>
+        struct WaitAwaiter
         {
-            std::uint32_t old = mFutex.load(std::memory_order_relaxed);
-            do{
-                co_await co_await futex_wait(&mFutex,old);
-            }while(mFutex.load(std::memory_order_acquire) == old);
+            ConditionVariable *mCv;
+            Waiter *mWaiter;
+            Pred &mPred;
+            bool mParked = false;
+
+            bool await_ready() const noexcept { return false; }
+
+            bool await_suspend(std::coroutine_handle<> coroutine)
+            {
+                mWaiter->mPrevious = coroutine;
+                mWaiter->mContext = IOContext::instance;
+                std::lock_guard guard(mCv->mLock);
+                // 先登记再检查条件，与 notify 中先修改条件再读 mNumWaiters 配对，两边至少有一方能看到对方
+                mCv->mNumWaiters.fetch_add(1, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if(mPred())
+                {
+                    mCv->mNumWaiters.fetch_sub(1, std::memory_order_relaxed);
+                    return false;
+                }
+                mWaiter->mQueued = true;
+                mCv->mWaiters.push_back(*mWaiter);
+                mWaiter->mContext->expectPost();
+                mParked = true;
+                return true;
+            }
+
+            void await_resume() const noexcept
+            {
+                if(mParked)
+                    mWaiter->mContext->postReceived();
+            }
+        };
+
+        template <class Pred>
+        Task<Expected<>> doWait(Mask mask, Pred pred)
+        {
+            Waiter waiter;
+            waiter.mMask = mask;
+            {
+                CancelCallback _(co_await co_cancel, [this, &waiter] {
+                    cancelWaiter(&waiter);
+                });
+                co_await WaitAwaiter<Pred>{this, &waiter, pred};
+            }
+            if(waiter.mCanceled)
+                co_return std::errc::operation_canceled;
             co_return {};
         }
 
-        void notify_one()
+        void cancelWaiter(Waiter *waiter)
         {
-            mFutex.fetch_add(1,std::memory_order_release);
-            futex_notify(&mFutex,1);
+            {
+                std::lock_guard guard(mLock);
+                if(!waiter->mQueued)
+                    return;
+                mWaiters.erase(*waiter);
+                waiter->mQueued = false;
+                waiter->mCanceled = true;
+                mNumWaiters.fetch_sub(1, std::memory_order_relaxed);
+            }
+            waiter->mContext->post(waiter->mPrevious);
         }
 
-        void notify_all()
+        // 唤醒最多 count 个掩码匹配的等待者
+        void doNotify(std::size_t count, Mask mask)
         {
-            mFutex.fetch_add(1,std::memory_order_release);
-            futex_notify(&mFutex,kFutexNotifyAll);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if(mNumWaiters.load(std::memory_order_relaxed) == 0)[[likely]]
+                return;
+            IntrusiveList<Waiter> ready;
+            {
+                std::lock_guard guard(mLock);
+                for(auto it = mWaiters.begin(); count != 0 && it != mWaiters.end();)
+                {
+                    auto &waiter = *it++;
+                    if(waiter.mMask & mask)
+                    {
+                        mWaiters.erase(waiter);
+                        waiter.mQueued = false;
+                        ready.push_back(waiter);
+                        mNumWaiters.fetch_sub(1, std::memory_order_relaxed);
+                        --count;
+                    }
+                }
+            }
+            // 先摘下再 post，post 之后等待者随时可能恢复并销毁节点
+            while(auto waiter = ready.pop_front())
+                waiter->mContext->post(waiter->mPrevious);
         }
 
-        using Mask = std::uint32_t;
+    public:
+        ConditionVariable() = default;
+        ConditionVariable(ConditionVariable &&) = delete;
+
+        Task<Expected<>> wait()
+        { return doWait(kMaskAll, [] { return false; }); }
 
         Task<Expected<>> wait(Mask mask)
-        {
-            std::uint32_t old = mFutex.load(std::memory_order_relaxed);
-            do{
-                co_await co_await futex_wait(&mFutex,old,mask);
-            }while(mFutex.load(std::memory_order_acquire) == old);
-            co_return {};
-        }
+        { return doWait(mask, [] { return false; }); }
+
+        // pred 为真时不挂起；跨线程使用时用它来避免丢失唤醒，pred 会在内部锁内调用，不能再操作本条件变量
+        Task<Expected<>> wait(std::invocable auto pred)
+        { return doWait(kMaskAll, std::move(pred)); }
+
+        Task<Expected<>> wait(Mask mask, std::invocable auto pred)
+        { return doWait(mask, std::move(pred)); }
+
+        void notify_one()
+        { doNotify(1, kMaskAll); }
+
+        void notify_all()
+        { doNotify(std::numeric_limits<std::size_t>::max(), kMaskAll); }
 
         void notify_one(Mask mask)
-        {
-            mFutex.fetch_add(1,std::memory_order_release);
-            futex_notify(&mFutex,1,mask);
-        }
+        { doNotify(1, mask); }
 
         void notify_all(Mask mask)
-        {
-            mFutex.fetch_add(1,std::memory_order_release);
-            futex_notify(&mFutex,kFutexNotifyAll,mask);
-        }
+        { doNotify(std::numeric_limits<std::size_t>::max(), mask); }
 
+        // 一次加锁唤醒最多 count 个等待者，供批量操作按放入/取出的元素数唤醒
+        void notify_n(std::size_t count, Mask mask = kMaskAll)
+        { doNotify(count, mask); }
     };
-} //namespace zh_async
\ No newline at end of file
+} //namespace zh_async
@@ -4,35 +4,67 @@
 namespace zh_async
 {
 
-GenericIOContext::GenericIOContext() = default;
+GenericIOContext::GenericIOContext(
+    std::optional<std::chrono::steady_clock::duration> wheelTick, bool coarseClock)
+    : mCoarseClock(coarseClock)
+{
+    if(wheelTick)
+        mWheel = std::make_unique<TimingWheel<TimerNode>>(*wheelTick);
+}
 GenericIOContext::~GenericIOContext() = default;
 
+std::chrono::steady_clock::time_point GenericIOContext::clockNow() const noexcept
+{
+    if(mCoarseClock)
+    {
+        // 和 steady_clock 同一个时间起点，只是按内核 tick 更新，读取不需要访问时钟硬件
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+        return std::chrono::steady_clock::time_point(
+            std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec)));
+    }
+    return std::chrono::steady_clock::now();
+}
+
 std::optional<std::chrono::steady_clock::duration>
 GenericIOContext::runDuration()
 {
     /*
-        无限循环直至红黑树为空
+        整批处理到期的计时器：只读一次时钟，之后把不晚于这个时间点的计时器依次取下并恢复
+        恢复的协程可能会取消同一批里还没恢复的计时器，所以不预先摘下整批，而是每次从树上取最左节点
+        批处理期间新到期的计时器留到下一轮，返回的等待时间以这次读到的时间为准
     */
-    while(true)
+    auto now = clockNow();
+    if(mWheel)[[unlikely]]
+        return runWheelDuration(now);
+    while(!mTimers.empty())
     {
-        if(!mTimers.empty())
-        {
-            auto &promise = mTimers.front();
-            std::chrono::steady_clock::time_point now = 
-            std::chrono::steady_clock::now();
-            if(promise.mExpires <= now) //如果计时器到期
-            {
-                promise.mCancelled = false; //设置取消令牌为false
-                promise.erase_from_parent();//从树上删除节点
-                std::coroutine_handle<TimerNode>::from_promise(promise).resume();//恢复与该计时器关联的协程，使其继续执行
-                continue;
-            }
-            else
-                return promise.mExpires - now;//如果还未到期，返回时间差
-        }
-        else
-            return std::nullopt;
+        auto &promise = mTimers.front();
+        if(promise.mExpires > now)
+            return promise.mExpires - now;//如果还未到期，返回时间差
+        promise.mCancelled = false; //设置取消令牌为false
+        promise.erase_from_parent();//从树上删除节点
+        std::coroutine_handle<TimerNode>::from_promise(promise).resume();//恢复与该计时器关联的协程，使其继续执行
     }
+    return std::nullopt;
 }
 
-}
\ No newline at end of file
+std::optional<std::chrono::steady_clock::duration>
+GenericIOContext::runWheelDuration(std::chrono::steady_clock::time_point now)
+{
+    mWheel->advance(now);
+    // 恢复的协程可能取消同一批到期的其他计时器，所以每次都从时间轮重新取
+    while(TimerNode *promise = mWheel->pop_expired())
+    {
+        promise->mCancelled = false;
+        std::coroutine_handle<TimerNode>::from_promise(*promise).resume();
+    }
+    // 高层槽位给出的是 cascade 的时间点，可能比真实到期早，届时再推进一次即可
+    auto next = mWheel->next_expiry();
+    if(!next)
+        return std::nullopt;
+    return std::max(*next - now, std::chrono::steady_clock::duration::zero());
+}
+
+}
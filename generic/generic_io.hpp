@@ -10,8 +10,8 @@
 #include <utils/rbtree.hpp>
 #include <utils/ring_queue.hpp>
 #include <utils/spin_mutex.hpp>
+#include <utils/timing_wheel.hpp>
 #include <utils/uninitialized.hpp>
-#include <generic/thread_pool.hpp>
 
 /*
     使用流程
@@ -39,7 +39,8 @@ namespace zh_async
             并且结合C++20协程的暂停/恢复能力，实现非阻塞的高精度计时
         */
         struct TimerNode : 
-        CustomPromise<Expected<>,TimerNode>,RbTree<TimerNode>::NodeType
+        CustomPromise<Expected<>,TimerNode>,RbTree<TimerNode>::NodeType,
+        TimingWheel<TimerNode>::NodeType
         {
             using RbTree<TimerNode>::NodeType::erase_from_parent;
             std::chrono::steady_clock::time_point mExpires; // 到期时间点
@@ -47,10 +48,11 @@ namespace zh_async
             CancelToken mCancelToken;   //取消源
             bool mCancelled = false;
 
-            void doCancel() //从红黑树上取消计时器
+            void doCancel() //从红黑树或时间轮上取消计时器
             {
                 mCancelled = true;
                 erase_from_parent();// O(log N)的复杂度
+                TimingWheel<TimerNode>::NodeType::erase_from_parent();// O(1)，不在时间轮上时什么都不做
             }
 
             bool operator<(TimerNode const &that)const
@@ -81,9 +83,20 @@ namespace zh_async
         runDuration();
 
         [[gnu::hot]] void enqueueTimerNode(TimerNode &promise){
-            mTimers.insert(promise);
+            if(mWheel)[[unlikely]]
+                mWheel->insert(promise, promise.mExpires);
+            else
+                mTimers.insert(promise);
         }
-        GenericIOContext();
+        /*
+            默认用红黑树存放计时器，插入和取消 O(log N)，按到期时间精确唤醒
+            给出 wheelTick 时改用分层时间轮，插入和取消 O(1)，到期时间向上取整到 tick
+            适合连接很多、超时大多会被取消的场景
+            coarseClock 为 true 时用 CLOCK_MONOTONIC_COARSE 判断到期，读时钟更便宜，但计时器可能推迟一个内核 tick（1~4ms）
+        */
+        explicit GenericIOContext(
+            std::optional<std::chrono::steady_clock::duration> wheelTick = std::nullopt,
+            bool coarseClock = false);
         ~GenericIOContext();
 
         GenericIOContext(GenericIOContext &&) = delete;
@@ -98,7 +111,13 @@ namespace zh_async
         static inline thread_local GenericIOContext *instance;
 
     private:
+        std::chrono::steady_clock::time_point clockNow() const noexcept;
+        std::optional<std::chrono::steady_clock::duration>
+        runWheelDuration(std::chrono::steady_clock::time_point now);
+
         RbTree<TimerNode> mTimers;  // 存储所有活跃计时器
+        std::unique_ptr<TimingWheel<TimerNode>> mWheel;    // 选用时间轮时非空，此时 mTimers 不再使用
+        bool mCoarseClock = false;  // 用粗粒度时钟判断到期
     };
 
 inline void GenericIOContext::TimerNode::Awaiter::await_suspend
@@ -120,6 +139,9 @@ inline void GenericIOContext::TimerNode::Awaiter::await_suspend
     template<Awaitable A>
     inline void co_spawn(A awaitable)
     {
+#if ZH_ASYNC_ALLOC
+        check_detach_allowed();
+#endif
         auto wrapped = coSpawnStarter(std::move(awaitable));
         auto coroutine = wrapped.release();
         coroutine.resume();
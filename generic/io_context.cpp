@@ -2,13 +2,16 @@
 #include <awaiter/task.hpp>
 #include <generic/generic_io.hpp>
 #include <generic/io_context.hpp>
+#include <generic/io_context_mt.hpp>
 #include <platform/futex.hpp>
 #include <platform/platform_io.hpp>
 #include <utils/cacheline.hpp>
+#include <utils/spin_mutex.hpp>
 
 namespace zh_async
 {
     IOContext::IOContext(IOContextOptions options)
+        : mGenericIO(options.timerWheelTick, options.coarseClock)
     {
         if(instance)
         throw std::logic_error("each thread may create only one IOContext");
@@ -21,8 +24,17 @@ namespace zh_async
         if(options.threadAffinity)
             PlatformIOContext::schedSetThreadAffinity(*options.threadAffinity);
 
-        mPlatformIO.setup(options.queueEntries);
+        mPlatformIO.setup(options.queueEntries, options.ringSetup);
         mMaxSleep = options.maxSleep;
+        mBusyPollMax = options.busyPoll;
+        mKernelTimers = options.kernelTimers;
+        // COOP/DEFER_TASKRUN 下没有 TASKRUN_FLAG 就无从得知何时该进入内核收割，自旋只会白白耗尽预算
+        auto flags = mPlatformIO.setupFlags();
+        if((flags & (IORING_SETUP_COOP_TASKRUN | IORING_SETUP_DEFER_TASKRUN)) &&
+           !(flags & IORING_SETUP_TASKRUN_FLAG))
+            mBusyPollMax = std::chrono::steady_clock::duration::zero();
+        mArrivalGap = mBusyPollMax;
+        mLastArrival = std::chrono::steady_clock::now();
     }
 
     IOContext::~IOContext()
@@ -41,6 +53,48 @@ namespace zh_async
         */
         while(runOnce());
     }
+
+    void IOContext::run(std::stop_token stop)
+    {
+        while(!stop.stop_requested())[[likely]]
+        {
+#if ZH_ASYNC_STEAL
+            // 本地运行队列还有积压时先恢复，不进入内核；否则不阻塞地收割一轮（没有要提交的 SQE 时只在用户态收割）
+            // 都没有就绪的协程时去偷其他 worker 积压的，还没有才睡眠
+            mGenericIO.runDuration();
+            if(mPlatformIO.numReady() != 0 ||
+               mPlatformIO.waitEventsFor(std::chrono::steady_clock::duration::zero()))
+            {
+                runReady();
+                continue;
+            }
+            if(IOContextMT::steal_and_run(*this))
+                continue;
+            IOContextMT::set_idle(*this, true);
+            if(!runOnce())
+            {
+                mPlatformIO.waitEventsFor(std::nullopt);
+                runReady();
+            }
+            IOContextMT::set_idle(*this, false);
+#else
+            // 暂时无事可做时一直睡到有协程被投递进来（停止请求也是通过投递唤醒的）
+            if(!runOnce())
+                mPlatformIO.waitEventsFor(std::nullopt);
+#endif
+        }
+    }
+
+#if ZH_ASYNC_STEAL
+    void IOContext::runReady()
+    {
+        // 积压了不止一个协程时叫醒一个空闲的 worker 来分担
+        if(mPlatformIO.numReady() > 1 && IOContextMT::instance)
+            IOContextMT::wake_idle_worker();
+        while(auto task = mPlatformIO.popReady())
+            task->resume();
+    }
+#endif
     
     //处理IO上下文事件
     bool IOContext::runOnce()
@@ -50,10 +104,23 @@ namespace zh_async
         if(!duration && !mPlatformIO.hasPendingEvents())
         [[unlikely]]{ return false; }
 
-        if(!duration || *duration > mMaxSleep)
+        // 没有上限时 duration 可能为空，表示一直睡到有 I/O 完成或被投递协程
+        if(mMaxSleep && (!duration || *duration > *mMaxSleep))
             duration = mMaxSleep;
 
-        mPlatformIO.waitEventsFor(duration);
+        if(mBusyPollMax == std::chrono::steady_clock::duration::zero())[[likely]]
+            mPlatformIO.waitEventsFor(duration);
+        else
+        {
+            if(duration != std::chrono::steady_clock::duration::zero()
+               && busyPoll(duration.value_or(mBusyPollMax)))
+                duration = std::chrono::steady_clock::duration::zero();
+            if(mPlatformIO.waitEventsFor(duration))
+                recordArrival();
+        }
+#if ZH_ASYNC_STEAL
+        runReady();
+#endif
         /*
             该函数会阻塞，直到：
             1、有IO事件发生
@@ -63,6 +130,33 @@ namespace zh_async
         return true;
     }
 
+    bool IOContext::busyPoll(std::chrono::steady_clock::duration limit)
+    {
+        // 最近的事件间隔比自旋上限还长，自旋大概率等不到，直接睡眠
+        if(mArrivalGap > mBusyPollMax)
+            return false;
+        auto budget = std::min({mArrivalGap * 2, mBusyPollMax, limit});
+        // 自旋期间不会进入内核，先把攒下的 SQE 提交出去
+        mPlatformIO.submitPending();
+        auto deadline = std::chrono::steady_clock::now() + budget;
+        do
+        {
+            if(mPlatformIO.peekEvents())
+                return true;
+            cpu_relax();
+        }while(std::chrono::steady_clock::now() < deadline);
+        return false;
+    }
+
+    void IOContext::recordArrival()
+    {
+        auto now = std::chrono::steady_clock::now();
+        auto gap = now - mLastArrival;
+        mLastArrival = now;
+        // 权重 1/8 的滑动平均，突发流量下很快收敛，偶尔一次长间隔不会让自旋完全失效
+        mArrivalGap += (gap - mArrivalGap) / 8;
+    }
+
     //通过thread_local关键字保证每个线程只有一个实例
     thread_local IOContext *IOContext::instance;
 
@@ -18,9 +18,30 @@ namespace zh_async
 
     struct IOContextOptions
     {
-        std::chrono::steady_clock::duration maxSleep = std::chrono::milliseconds(114);
+        /*
+            单次睡眠的上限，到点即使无事可做也会醒来轮询一次
+            设为 std::nullopt 进入事件驱动的空闲模式：只在下一个计时器到期、I/O 完成或被投递协程时醒来，
+            跨线程唤醒都经过 MSG_RING / eventfd 门铃，空闲的事件循环不再周期性醒来
+        */
+        std::optional<std::chrono::steady_clock::duration> maxSleep = std::chrono::milliseconds(114);
         std::optional<std::size_t> threadAffinity = std::nullopt;
         std::size_t queueEntries = 512; 
+        RingSetupOptions ringSetup{};   // SQPOLL 等建环模式，内核不支持时自动退回
+        /*
+            睡眠前忙轮询完成队列的最长时间，0 表示不自旋（默认）
+            实际自旋时长按最近事件到达间隔自适应：间隔超过上限时直接睡眠，否则自旋约两倍间隔
+            用 CPU 换更低的唤醒延迟；COOP/DEFER_TASKRUN 下靠 TASKRUN_FLAG 得知何时进入内核执行任务，内核不支持该标志时不自旋
+        */
+        std::chrono::steady_clock::duration busyPoll = std::chrono::steady_clock::duration::zero();
+        // 设置后计时器改用该精度的分层时间轮（插入和取消 O(1)），不设置时使用红黑树
+        std::optional<std::chrono::steady_clock::duration> timerWheelTick = std::nullopt;
+        // 用 CLOCK_MONOTONIC_COARSE 判断计时器到期，省下读时钟的开销，代价是超时可能推迟几毫秒
+        bool coarseClock = false;
+        /*
+            为 true 时 co_sleep 默认交给 io_uring 在内核里计时（co_sleep_kernel），
+            唤醒精度不再取决于事件循环何时醒来，代价是每次睡眠多一个 SQE 和一次取消往返
+        */
+        bool kernelTimers = false;
     };
 
     /*
@@ -31,7 +52,14 @@ namespace zh_async
     private:
         GenericIOContext mGenericIO;                    // 定时器任务
         PlatformIOContext mPlatformIO;                  // 底层IO事件，直接与操作系统交互
-        std::chrono::steady_clock::duration mMaxSleep;  // 最大休眠时间
+        std::optional<std::chrono::steady_clock::duration> mMaxSleep;  // 最大休眠时间，空表示不设上限
+        std::chrono::steady_clock::duration mBusyPollMax;   // 忙轮询上限，0 表示关闭
+        std::chrono::steady_clock::duration mArrivalGap;    // 事件到达间隔的指数滑动平均
+        std::chrono::steady_clock::time_point mLastArrival; // 上一次收割到事件的时间
+        bool mKernelTimers;                             // co_sleep 是否默认使用内核计时
+        std::size_t mWorkerId = static_cast<std::size_t>(-1);  // 在 IOContextMT 中的编号，启动时写入
+
+        friend struct IOContextMT;
 
     public:
         explicit IOContext(IOContextOptions options = {});
@@ -39,11 +67,55 @@ namespace zh_async
         ~IOContext();
         //标记为热点函数，采用更积极的优化
         [[gnu::hot]] void run();
+        // 常驻运行：没有任务时也不退出，阻塞等待投递过来的协程，直到 stop 被请求（IOContextMT 的 worker 使用）
+        [[gnu::hot]] void run(std::stop_token stop);
         [[gnu::hot]] bool runOnce();    
 
+        // 把协程交给这个 IOContext 所在的线程恢复，可以在任意线程调用，会立即唤醒正在睡眠的事件循环
+        void post(std::coroutine_handle<> coroutine)
+        { mPlatformIO.post(coroutine); }
+
+        // 等待其他线程 post 回来期间让事件循环保持运行，两者必须在本线程成对调用
+        void expectPost() noexcept
+        { mPlatformIO.expectPost(); }
+
+        void postReceived() noexcept
+        { mPlatformIO.postReceived(); }
+
+        bool kernelTimers() const noexcept
+        { return mKernelTimers; }
+
+    private:
+        // 睡眠前不进入内核地自旋等待事件，等到了返回 true
+        bool busyPoll(std::chrono::steady_clock::duration limit);
+        void recordArrival();
+
+    public:
+#if ZH_ASYNC_STEAL
+        // 供其他 worker 窃取本地运行队列顶部的协程，可以在任意线程调用
+        std::optional<std::coroutine_handle<>> steal()
+        { return mPlatformIO.stealReady(); }
+
+    private:
+        // 依次恢复本地运行队列中的协程
+        void runReady();
+
+    public:
+#endif
         static thread_local IOContext *instance;
     };
 
+    // 在指定的 IOContext 上启动协程，常用于把请求分发到 IOContextMT 的其他 worker
+    template<Awaitable A>
+    inline void co_spawn(IOContext &context, A awaitable)
+    {
+#if ZH_ASYNC_ALLOC
+        check_detach_allowed();
+#endif
+        auto wrapped = coSpawnStarter(std::move(awaitable));
+        context.post(wrapped.release());
+    }
+
     // 用于将一个 Task 提交给当前线程的 IOContext
     inline Task<> co_catch(Task<Expected<>> task)
     {
@@ -16,16 +16,170 @@ namespace zh_async
     }
 
     IOContextMT::~IOContextMT(){
+        if(mThreads)
+        {
+            stop();
+            join();
+        }
         IOContextMT::instance = nullptr;
     }
 
-    void IOContextMT::run(std::size_t numWorkers)
+    void IOContextMT::start(IOContextMTOptions options)
     {
-        instance->mWorkers = std::make_unique<IOContext[]>(numWorkers);
+        startWorkers(std::move(options), true, {});
+    }
+
+    void IOContextMT::startWorkers(IOContextMTOptions options, bool resident,
+                                   std::function<void(std::size_t)> const &init)
+    {
+        if(instance->mThreads)[[unlikely]]
+        throw std::logic_error("IOContextMT is already running");
+
+        std::size_t numWorkers = options.numWorkers;
+        if(!numWorkers)
+            numWorkers = std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+
+        instance->mWorkers = std::make_unique<IOContext *[]>(numWorkers);
+        instance->mThreads = std::make_unique<std::jthread[]>(numWorkers);
+        instance->mExited = std::make_unique<std::latch>(static_cast<std::ptrdiff_t>(numWorkers));
+#if ZH_ASYNC_STEAL
+        instance->mIdle = std::make_unique<std::atomic<bool>[]>(numWorkers);
+#endif
         instance->mNumWorkers = numWorkers;
+
+        instance->mReady = std::make_unique<std::latch>(static_cast<std::ptrdiff_t>(numWorkers));
+        std::vector<std::exception_ptr> errors(numWorkers);
+        std::vector<std::exception_ptr> initErrors(numWorkers);
+        for(std::size_t i = 0; i < numWorkers; i++)
+        {
+            IOContextOptions workerOptions = options.workerOptions;
+            if(!options.cpuAffinity.empty())
+                workerOptions.threadAffinity = options.cpuAffinity[i % options.cpuAffinity.size()];
+
+            instance->mThreads[i] = std::jthread(
+                [i, workerOptions, resident, init, &errors, &initErrors](std::stop_token stop)
+                {
+                    // IOContext 必须在自己的线程上构造，线程亲和度也在构造时设置
+                    std::optional<IOContext> ctx;
+                    try{
+                        ctx.emplace(workerOptions);
+                    }catch(...){
+                        errors[i] = std::current_exception();
+                        instance->mExited->count_down();
+                        instance->mReady->count_down();
+                        return;
+                    }
+                    ctx->mWorkerId = i;
+                    instance->mWorkers[i] = &*ctx;
+                    /*
+                        停止请求由调用 stop() 的线程执行这个回调，投递一个空协程把正在睡眠的 worker 叫醒
+                        stop_callback 析构时会等待正在执行的回调结束，保证 ctx 不会先于投递被销毁
+                    */
+                    std::stop_callback wake(stop, [&ctx]{ ctx->post(std::noop_coroutine()); });
+                    // 所有 worker 都发布了自己的 IOContext 之后才开始运行，之后可以放心地互相投递和窃取
+                    instance->mReady->arrive_and_wait();
+                    // 只有非常驻模式传入 init，调用方 join 之后才读 initErrors
+                    // init 失败时已经 co_spawn 的协程照常运行完，不能随 ctx 一起丢掉
+                    if(init)
+                    {
+                        try{
+                            init(i);
+                        }catch(...){
+                            initErrors[i] = std::current_exception();
+                        }
+                    }
+                    if(resident)
+                        ctx->run(stop);
+                    else
+                        ctx->run();
+                    // 其他 worker 可能还在向这里投递或窃取，等大家都退出循环再销毁
+                    instance->mExited->arrive_and_wait();
+                });
+        }
+        instance->mReady->wait();
+
+        for(auto &e : errors)
+        {
+            if(e)[[unlikely]]
+            {
+                stop();
+                join();
+                std::rethrow_exception(e);
+            }
+        }
+        if(resident)
+            return;
+        join();
+        for(auto &e : initErrors)
+            if(e)[[unlikely]]
+                std::rethrow_exception(e);
+    }
+
+    void IOContextMT::stop()
+    {
+        for(std::size_t i = 0; i < instance->mNumWorkers; i++)
+            instance->mThreads[i].request_stop();
+    }
+
+    void IOContextMT::join()
+    {
+        for(std::size_t i = 0; i < instance->mNumWorkers; i++)
+            if(instance->mThreads[i].joinable())
+                instance->mThreads[i].join();
+        instance->mThreads.reset();
+        instance->mWorkers.reset();
+        instance->mReady.reset();
+        instance->mExited.reset();
+#if ZH_ASYNC_STEAL
+        instance->mIdle.reset();
+#endif
+        instance->mNumWorkers = 0;
+    }
+
+    void IOContextMT::run(std::function<void(std::size_t)> const &init, std::size_t numWorkers)
+    {
+        startWorkers(IOContextMTOptions{.numWorkers = numWorkers}, false, init);
+    }
+
+#if ZH_ASYNC_STEAL
+    bool IOContextMT::steal_and_run(IOContext &thief)
+    {
+        std::size_t n = instance->mNumWorkers;
+        std::size_t self = get_worker_id(thief);
+        if(self >= n || n < 2)[[unlikely]]
+            return false;
+        // 每次从不同的位置开始找，避免所有空闲 worker 都盯着同一个受害者
+        static thread_local std::size_t offset = 0;
+        ++offset;
+        for(std::size_t k = 0; k < n - 1; k++)
+        {
+            std::size_t victim = (self + 1 + (offset + k) % (n - 1)) % n;
+            // 启动期间其他 worker 可能还没构造好
+            IOContext *context = instance->mWorkers[victim];
+            if(!context)
+                continue;
+            if(auto task = context->steal())
+            {
+                task->resume();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void IOContextMT::wake_idle_worker()
+    {
         for(std::size_t i = 0; i < instance->mNumWorkers; i++)
-            instance->mWorkers[i].run();
+        {
+            bool idle = true;
+            if(instance->mIdle[i].compare_exchange_strong(idle, false) && instance->mWorkers[i])
+            {
+                instance->mWorkers[i]->post(std::noop_coroutine());
+                return;
+            }
+        }
     }
+#endif
 
     IOContextMT *IOContextMT::instance;
-} //namespace zh_async
\ No newline at end of file
+} //namespace zh_async
@@ -7,25 +7,48 @@
 
 namespace zh_async
 {
+    struct IOContextMTOptions
+    {
+        std::size_t numWorkers = 0;             // worker 数量，0 表示使用 std::thread::hardware_concurrency()
+        std::vector<std::size_t> cpuAffinity{}; // 第 i 个 worker 绑定到 cpuAffinity[i % size()]，为空则不绑定
+        IOContextOptions workerOptions{};       // 每个 worker 的 IOContext 选项
+    };
+
     /*
         IOContext 实现的是一个单线程的 Reactor 模型：一个线程，一个事件循环，处理所有 I/O 和协程
         IOContextMT 则将其扩展为多线程的 Reactor 池模型：
         它创建并管理一个线程池，池中的每个线程都运行一个独立的 IOContext 事件循环
+        每个 IOContext 都在自己的线程上构造（线程局部的 instance 和 io_uring 都属于该线程），
+        其他线程通过 IOContext::post / co_spawn(IOContext &, ...) 向它投递协程
     */
     struct IOContextMT
     {
     private:
-        std::unique_ptr<IOContext[]> mWorkers;  // 管理多个 IOContext
+        std::unique_ptr<IOContext *[]> mWorkers;    // 各 worker 线程栈上的 IOContext
+        std::unique_ptr<std::jthread[]> mThreads;   // 各 worker 线程
+        std::unique_ptr<std::latch> mReady;         // 所有 worker 的 IOContext 都构造完成
+        std::unique_ptr<std::latch> mExited;        // 所有 worker 的事件循环都退出后才销毁各自的 IOContext
         std::size_t mNumWorkers = 0;
+#if ZH_ASYNC_STEAL
+        std::unique_ptr<std::atomic<bool>[]> mIdle; // 正在睡眠、可以被叫醒来窃取的 worker
+#endif
+
+        /*
+            resident 为 true 时 worker 常驻直到 stop()，否则本地无事可做时退出，全部退出后才返回
+            init 非空时在每个 worker 线程上、所有 worker 就绪之后、事件循环开始之前调用 init(worker 编号)
+        */
+        static void startWorkers(IOContextMTOptions options, bool resident,
+                                 std::function<void(std::size_t)> const &init);
 
     public:
         IOContextMT();
         IOContextMT(IOContext &&) = delete;
         ~IOContextMT();
 
+        // 不属于本 IOContextMT 的上下文返回 num_workers()
         static std::size_t get_worker_id(IOContext const &context)noexcept
         {
-          return static_cast<std::size_t>(&context - instance->mWorkers.get());
+            return std::min(context.mWorkerId, instance->mNumWorkers);
         }
 
         static std::size_t this_worker_id()noexcept
@@ -33,9 +56,12 @@ namespace zh_async
             return get_worker_id(*IOContext::instance);
         }
 
-        static IOContext &nth_worker(std::size_t index)noexcept
+        // 没有在运行（未启动、启动失败或已经 join）或编号越界时抛出 std::out_of_range
+        static IOContext &nth_worker(std::size_t index)
         {
-            return instance->mWorkers[index];
+            if(!instance || index >= instance->mNumWorkers || !instance->mWorkers[index])[[unlikely]]
+                throw std::out_of_range("IOContextMT::nth_worker: no such running worker");
+            return *instance->mWorkers[index];
         }
 
         static std::size_t num_workers()noexcept
@@ -43,8 +69,40 @@ namespace zh_async
             return instance->mNumWorkers;
         }
 
-        static void run(std::size_t numWorkers = 0);
+        // 启动所有 worker 线程，等到每个 worker 的 IOContext 都构造完成后返回
+        static void start(IOContextMTOptions options = {});
+        // 请求所有 worker 停止，正在睡眠的 worker 会被立即唤醒，可以在任意线程（包括 worker 自己）调用
+        static void stop();
+        // 等待所有 worker 线程退出
+        static void join();
+        /*
+            与原先的行为一致：每个 worker 的事件循环在本地无事可做时退出，全部退出后返回，不需要调用 stop()
+            worker 启动时还没有任何协程，初始任务由 init(worker 编号) 在该 worker 线程上 co_spawn，
+            init 抛出的第一个异常在所有 worker 退出后重新抛出
+            worker 退出之后再向它投递的协程不会被执行，需要常驻的 worker 时使用 start / stop / join
+        */
+        static void run(std::function<void(std::size_t)> const &init, std::size_t numWorkers = 0);
+
+#if ZH_ASYNC_STEAL
+        /*
+            工作窃取（ZH_ASYNC_STEAL）：
+            每个 worker 把 waitEventsFor 收割到的就绪协程放进自己的 Chase-Lev 运行队列
+            积压超过一个时叫醒一个空闲 worker，空闲 worker 从其他 worker 的队列顶部偷协程来恢复
+            被偷走的协程之后会在窃取者的线程上继续运行（包括它之后提交的 I/O 和定时器），
+            因此只适合不依赖线程亲和度的协程
+        */
+        // 从其他 worker 偷一个协程并恢复，成功返回 true
+        static bool steal_and_run(IOContext &thief);
+        // 叫醒一个正在睡眠的 worker
+        static void wake_idle_worker();
+        static void set_idle(IOContext &context, bool idle)noexcept
+        {
+            std::size_t id = get_worker_id(context);
+            if(id < instance->mNumWorkers)
+                instance->mIdle[id].store(idle);
+        }
+#endif
 
         static IOContextMT *instance;
     };
-}
\ No newline at end of file
+}
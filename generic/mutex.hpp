@@ -1,38 +1,167 @@
 #pragma once
 #include <std.hpp>
 #include <awaiter/task.hpp>
-#include <platform/futex.hpp>
+#include <generic/cancel.hpp>
+#include <generic/io_context.hpp>
+#include <utils/cacheline.hpp>
+#include <utils/ilist.hpp>
 #include <utils/non_void_helper.hpp>
+#include <utils/spin_mutex.hpp>
 
 namespace zh_async
 {
+    /*
+        公平的异步互斥锁
+        mState 第 0 位表示已上锁，第 1 位表示等待队列非空（只在持有 mWaitersLock 时修改）
+            无人等待时 lock / unlock 都只是一次 CAS，不进入内核，也不发唤醒
+            有人等待时 unlock 并不释放锁，而是把锁直接交给队首的等待者（先进先出），再把它 post 回所属的 IOContext，
+                被唤醒的协程不需要重新抢锁，也就不会一次唤醒一群；队列非空时新来的 lock 不能插队
+        spinCount 不为 0 时，lock 在排队之前先自旋尝试若干次，适合临界区很短、持锁者在其他线程上的情况
+        等待者节点放在 lock() 的协程帧里，排队不需要分配内存
+    */
     struct BasicMutex
     {
     private:
-        FutexAtomic<bool> mFutex;
+        static constexpr std::uint32_t kLocked = 1;
+        static constexpr std::uint32_t kHasWaiters = 2;
+
+        struct Waiter : IntrusiveList<Waiter>::NodeType
+        {
+            std::coroutine_handle<> mPrevious;
+            IOContext *mContext = nullptr;
+            bool mQueued = false;   // 是否还在等待队列中
+            bool mCanceled = false;
+        };
+
+        std::atomic<std::uint32_t> mState{0};
+        std::uint32_t mSpinCount;
+        SpinMutex mWaitersLock;
+        IntrusiveList<Waiter> mWaiters;
+
+        // 锁已释放时直接取得并返回 false，否则排到队尾并返回 true
+        bool enqueue(Waiter *waiter)
+        {
+            std::lock_guard guard(mWaitersLock);
+            std::uint32_t state = mState.load(std::memory_order_relaxed);
+            while(true)
+            {
+                if(!(state & kLocked))
+                {
+                    if(mState.compare_exchange_weak(state, state | kLocked,
+                                                    std::memory_order_acquire,
+                                                    std::memory_order_relaxed))
+                        return false;
+                }
+                else if(mState.compare_exchange_weak(state, state | kHasWaiters,
+                                                     std::memory_order_relaxed,
+                                                     std::memory_order_relaxed))
+                {
+                    waiter->mQueued = true;
+                    mWaiters.push_back(*waiter);
+                    waiter->mContext->expectPost();
+                    return true;
+                }
+            }
+        }
+
+        // 取消仍在排队的等待者，已经拿到锁的不受影响
+        void cancelWaiter(Waiter *waiter)
+        {
+            {
+                std::lock_guard guard(mWaitersLock);
+                if(!waiter->mQueued)
+                    return;
+                mWaiters.erase(*waiter);
+                waiter->mQueued = false;
+                waiter->mCanceled = true;
+                if(mWaiters.empty())
+                    mState.fetch_and(~kHasWaiters, std::memory_order_relaxed);
+            }
+            waiter->mContext->post(waiter->mPrevious);
+        }
+
+        struct LockAwaiter
+        {
+            BasicMutex *mMutex;
+            Waiter *mWaiter;
+            bool mParked = false;
+
+            bool await_ready() const noexcept { return false; }
+
+            bool await_suspend(std::coroutine_handle<> coroutine)
+            {
+                mWaiter->mPrevious = coroutine;
+                mWaiter->mContext = IOContext::instance;
+                mParked = mMutex->enqueue(mWaiter);
+                return mParked;
+            }
+
+            void await_resume() const noexcept
+            {
+                if(mParked)
+                    mWaiter->mContext->postReceived();
+            }
+        };
 
     public:
+        explicit BasicMutex(std::uint32_t spinCount = 0) noexcept
+            : mSpinCount(spinCount) {}
+
+        BasicMutex(BasicMutex &&) = delete;
+
         bool try_lock()
         {
-            bool old = mFutex.exchange(true,std::memory_order_acquire);
-            return old == false;
+            std::uint32_t state = 0;
+            return mState.compare_exchange_strong(state, kLocked,
+                                                  std::memory_order_acquire,
+                                                  std::memory_order_relaxed);
         }
 
         Task<Expected<>> lock()
         {
-            while(true)
+            if(try_lock())[[likely]]
+                co_return {};
+            for(std::uint32_t i = 0; i < mSpinCount; ++i)
             {
-                bool old = mFutex.exchange(true,std::memory_order_acquire);
-                if(old == false)
+                cpu_relax();
+                if(!(mState.load(std::memory_order_relaxed) & kLocked) && try_lock())
                     co_return {};
-                co_await co_await futex_wait(&mFutex,old);
             }
+            Waiter waiter;
+            {
+                CancelCallback _(co_await co_cancel, [this, &waiter] {
+                    cancelWaiter(&waiter);
+                });
+                co_await LockAwaiter{this, &waiter};
+            }
+            if(waiter.mCanceled)
+                co_return std::errc::operation_canceled;
+            co_return {};
         }
 
         void unlock()
         {
-            mFutex.store(false,std::memory_order_release);
-            futex_notify(&mFutex,1);
+            std::uint32_t state = kLocked;
+            if(mState.compare_exchange_strong(state, 0,
+                                              std::memory_order_release,
+                                              std::memory_order_relaxed))[[likely]]
+                return;
+            Waiter *waiter;
+            {
+                std::lock_guard guard(mWaitersLock);
+                waiter = mWaiters.pop_front();
+                if(!waiter)
+                {
+                    // 最后一个等待者刚被取消
+                    mState.store(0, std::memory_order_release);
+                    return;
+                }
+                waiter->mQueued = false;
+                // 锁直接归被唤醒的等待者所有，保持上锁状态
+                mState.store(mWaiters.empty() ? kLocked : kLocked | kHasWaiters,
+                             std::memory_order_release);
+            }
+            waiter->mContext->post(waiter->mPrevious);
         }
     };
 
@@ -57,8 +186,8 @@ namespace zh_async
             T &operator*()const 
                 { return mImp1->unsafe_access(); }
 
-            T &operator->() const{
-                return std::addressof(mImp1->unsafe_access();)
+            T *operator->() const{
+                return std::addressof(mImp1->unsafe_access());
             }
 
             explicit operator bool()const noexcept{
@@ -87,7 +216,7 @@ namespace zh_async
 
         private:
             MutexImp1 *mImp1;
-        }
+        };
 
         MutexImp1(MutexImp1 &&) = delete;
         MutexImp1(MutexImp1 const &) = delete;
@@ -101,7 +230,7 @@ namespace zh_async
 
         Locked try_lock()
         {
-            if(auto e = mMutex.try_lock())
+            if(mMutex.try_lock())
                 return Locked(this);
             else 
                 return Locked();
@@ -115,15 +244,15 @@ namespace zh_async
 
         T &unsafe_access() { return mValue; }
 
-        T const &unsafe_access() { return mMutex; }
+        T const &unsafe_access() const { return mValue; }
 
-        M &unsafe_access() { return mValue; }
+        M &unsafe_basic_mutex() { return mMutex; }
 
-        M const &unsafe_access() { return mMutex; }
+        M const &unsafe_basic_mutex() const { return mMutex; }
     };
 
     template<class M>
-    struct MutexImp1<M,void> : MutexImp1<M,void>{
+    struct MutexImp1<M,void> : MutexImp1<M,Void>{
         using MutexImp1<M,Void>::MutexImp1;
     };
 
@@ -135,7 +264,7 @@ namespace zh_async
     struct CallOnce
     {
     private:
-        std::atomic_bool mcalled{false};
+        std::atomic_bool mCalled{false};
         Mutex<> mMutex;
 
     public:
@@ -158,26 +287,26 @@ namespace zh_async
                 return static_cast<bool>(mLocked);
             }
 
+            // 与 call_once 快速路径上的 acquire 配对，之后看到已完成的协程也能看到初始化的结果
             void set_ready()const {
-                mImp1->mCalled.store(true,std::memory_order_relaxed);
+                mImp1->mCalled.store(true,std::memory_order_release);
             }
         };
 
-        Task<Locked> call_once()
+        /*
+            已经完成过时返回空的 Locked；否则返回持有锁的 Locked，调用方初始化完后调用 set_ready
+            排队等锁时被取消返回 operation_canceled，这时既没有拿到锁也不知道是否已经完成
+        */
+        Task<Expected<Locked>> call_once()
         {
-            if(mCalled.lock(std::memory_order_relaxed))
+            if(mCalled.load(std::memory_order_acquire))
                 co_return Locked();
 
-            while(true)
-            {
-                if(auto mtxLock = co_await mMutex.lock())
-                {
-                    Locked locked(std::move(*mtxLock),this);
-                    if(mCalled.load(std::memory_order_relaxed))
-                        co_return Locked();
-                    co_return std::move(locked);
-                }
-            }
+            auto mtxLock = co_await co_await mMutex.lock();
+            // 等锁期间前一个持有者可能已经完成了
+            if(mCalled.load(std::memory_order_relaxed))
+                co_return Locked();
+            co_return Locked(std::move(mtxLock),this);
         }
     };
 }
\ No newline at end of file
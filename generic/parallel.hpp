@@ -0,0 +1,234 @@
+#pragma once
+#include <std.hpp>
+#include <awaiter/task.hpp>
+#include <generic/cancel.hpp>
+#include <generic/io_context.hpp>
+#include <generic/thread_pool.hpp>
+#include <utils/cacheline.hpp>
+
+namespace zh_async
+{
+    /*
+        线程池上的并行循环，parallel_for / parallel_map / parallel_reduce 的公共部分
+        不为每个元素或每一块创建任务，而是向线程池提交不超过线程数的几个执行者（Runner）：
+            执行者在工作线程上反复领取下一段下标区间，直到领完、出错或被取消，
+            最后一个结束的执行者把等待的协程 post 回原来的 IOContext
+            同时在执行的块数不超过执行者个数，每次调用只分配一次执行者数组、只 post 一次
+        chunk 为 0 时自适应分块：每次领取剩余量 / (2 * 执行者数)，
+            开头的大块摊薄领取的原子操作，结尾的小块让各线程差不多同时结束
+        停止后执行者不再领取新块，已经开始的块会执行完
+        函数体抛出的第一个异常会让其他执行者停止领取，并在 co_await 处重新抛出
+    */
+    template <class Body>
+    struct ParallelLoop
+    {
+    private:
+        struct Runner : ThreadPoolJob
+        {
+            ParallelLoop *mLoop;
+            std::size_t mIndex;
+        };
+
+        Thread_pool *mPool;
+        Body mBody;  // mBody(begin, end, 执行者编号)
+        std::size_t mSize;
+        std::size_t mChunk;
+        std::vector<Runner> mRunners;
+        IOContext *mContext = nullptr;
+        std::coroutine_handle<> mPrevious;
+        std::exception_ptr mException;
+        alignas(hardware_destructive_interference_size) std::atomic<std::size_t> mNext{0};
+        alignas(hardware_destructive_interference_size) std::atomic<std::size_t> mRunning{0};
+        std::atomic<bool> mStop{false};
+        std::atomic<bool> mFailed{false};
+
+        // 领取下一段下标区间，全部领完时返回 false
+        bool claim(std::size_t &begin, std::size_t &end) noexcept
+        {
+            std::size_t next = mNext.load(std::memory_order_relaxed);
+            while(next < mSize)
+            {
+                std::size_t remaining = mSize - next;
+                std::size_t chunk = mChunk ? mChunk
+                                           : std::max<std::size_t>(1, remaining / (2 * mRunners.size()));
+                chunk = std::min(chunk, remaining);
+                if(mNext.compare_exchange_weak(next, next + chunk, std::memory_order_relaxed))
+                {
+                    begin = next;
+                    end = next + chunk;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        static void invoke(ThreadPoolJob *job) noexcept
+        {
+            auto runner = static_cast<Runner *>(job);
+            auto loop = runner->mLoop;
+            std::size_t begin, end;
+            while(!loop->mStop.load(std::memory_order_relaxed) && loop->claim(begin, end))
+            {
+                try {
+                    loop->mBody(begin, end, runner->mIndex);
+                } catch (...) {
+                    if(!loop->mFailed.exchange(true, std::memory_order_relaxed))
+                        loop->mException = std::current_exception();
+                    loop->mStop.store(true, std::memory_order_relaxed);
+                }
+            }
+            // 只有最后一个执行者能继续访问 loop，post 之后协程随时可能恢复并销毁它
+            if(loop->mRunning.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                loop->mContext->post(loop->mPrevious);
+        }
+
+    public:
+        ParallelLoop(Thread_pool &pool, std::size_t size, std::size_t chunk, Body body)
+            : mPool(&pool), mBody(std::move(body)), mSize(size), mChunk(chunk)
+        {
+            std::size_t numChunks = chunk ? (size + chunk - 1) / chunk : size;
+            std::size_t numRunners = std::min(pool.threads_count(), numChunks);
+            mRunners.reserve(numRunners);
+            for(std::size_t i = 0; i < numRunners; ++i)
+                mRunners.push_back(Runner{{&ParallelLoop::invoke}, this, i});
+            mRunning.store(numRunners, std::memory_order_relaxed);
+        }
+
+        ParallelLoop(ParallelLoop &&) = delete;
+
+        // 执行者个数，也是 mBody 收到的执行者编号的上界
+        std::size_t num_runners() const noexcept
+        { return mRunners.size(); }
+
+        // 只保存指针的等待者：co_await 一个不可移动的左值时 GCC 12 会试图复制它
+        struct Awaiter
+        {
+            ParallelLoop *mLoop;
+
+            bool await_ready() const noexcept
+            { return mLoop->mRunners.empty(); }
+
+            void await_suspend(std::coroutine_handle<> coroutine) const
+            {
+                // 完成通知要 post 回等待者的 IOContext，线程池的工作线程上没有，不能在那里嵌套调用
+                if(!IOContext::instance)[[unlikely]]
+                    throw std::logic_error("parallel loop awaited on a thread without an IOContext");
+                mLoop->mPrevious = coroutine;
+                mLoop->mContext = IOContext::instance;
+                mLoop->mContext->expectPost();
+                for(auto &runner : mLoop->mRunners)
+                    mLoop->mPool->submitJob(&runner);
+            }
+
+            void await_resume() const
+            {
+                if(mLoop->mContext)
+                    mLoop->mContext->postReceived();
+                if(mLoop->mException)[[unlikely]]
+                    std::rethrow_exception(mLoop->mException);
+            }
+        };
+
+        Awaiter operator co_await() noexcept
+        { return Awaiter{this}; }
+
+        // 执行循环，当前协程的取消令牌触发时停止领取新块并返回 operation_canceled
+        Task<Expected<>> run()
+        {
+            bool canceled = false;
+            {
+                CancelCallback _(co_await co_cancel, [this, &canceled] {
+                    canceled = true;
+                    mStop.store(true, std::memory_order_relaxed);
+                });
+                co_await Awaiter{this};
+            }
+            if(canceled)
+                co_return std::errc::operation_canceled;
+            co_return {};
+        }
+    };
+
+    /*
+        对 range 中的每个元素调用 fn，chunk 为每块的元素个数，0 表示自适应
+        range 需要在 co_await 期间保持有效，fn 会被多个线程同时调用
+    */
+    template <std::ranges::random_access_range R, class F>
+        requires std::ranges::sized_range<R> &&
+                 std::invocable<F &, std::ranges::range_reference_t<R>>
+    inline Task<Expected<>> parallel_for(Thread_pool &pool, R &&range,
+                                         std::size_t chunk, F fn)
+    {
+        auto first = std::ranges::begin(range);
+        ParallelLoop loop(pool, static_cast<std::size_t>(std::ranges::size(range)), chunk,
+                          [first, &fn](std::size_t begin, std::size_t end, std::size_t) {
+            for(std::size_t i = begin; i < end; ++i)
+                std::invoke(fn, first[static_cast<std::ranges::range_difference_t<R>>(i)]);
+        });
+        co_return co_await loop.run();
+    }
+
+    // 对每个元素调用 fn，按原顺序收集结果，结果类型需要可默认构造
+    template <std::ranges::random_access_range R, class F>
+        requires std::ranges::sized_range<R> &&
+                 std::invocable<F &, std::ranges::range_reference_t<R>>
+    inline auto parallel_map(Thread_pool &pool, R &&range, std::size_t chunk, F fn)
+        -> Task<Expected<std::vector<std::invoke_result_t<F &, std::ranges::range_reference_t<R>>>>>
+    {
+        using T = std::invoke_result_t<F &, std::ranges::range_reference_t<R>>;
+        // std::vector<bool> 按位存储，不同线程写相邻元素会互相覆盖
+        static_assert(!std::is_same_v<T, bool>, "parallel_map 不支持返回 bool，请改用 char 等类型");
+        auto first = std::ranges::begin(range);
+        std::vector<T> out(static_cast<std::size_t>(std::ranges::size(range)));
+        ParallelLoop loop(pool, out.size(), chunk,
+                          [first, &fn, &out](std::size_t begin, std::size_t end, std::size_t) {
+            for(std::size_t i = begin; i < end; ++i)
+                out[i] = std::invoke(fn, first[static_cast<std::ranges::range_difference_t<R>>(i)]);
+        });
+        co_await co_await loop.run();
+        co_return std::move(out);
+    }
+
+    /*
+        归约：每个执行者先用 op 合并自己领到的元素（经 proj 变换），最后在协程里把各执行者的结果并入 init
+        各块的合并顺序不确定，op 需要满足结合律和交换律
+    */
+    template <std::ranges::random_access_range R, class T, class Op,
+              class Proj = std::identity>
+        requires std::ranges::sized_range<R> &&
+                 std::invocable<Proj &, std::ranges::range_reference_t<R>>
+    inline Task<Expected<T>> parallel_reduce(Thread_pool &pool, R &&range,
+                                             std::size_t chunk, T init, Op op,
+                                             Proj proj = {})
+    {
+        // 每个执行者的部分结果独占缓存行，避免伪共享
+        struct alignas(hardware_destructive_interference_size) Partial
+        {
+            std::optional<T> mValue;
+        };
+
+        auto first = std::ranges::begin(range);
+        std::vector<Partial> partials;
+        ParallelLoop loop(pool, static_cast<std::size_t>(std::ranges::size(range)), chunk,
+                          [first, &op, &proj, &partials](std::size_t begin, std::size_t end,
+                                                         std::size_t runner) {
+            auto &acc = partials[runner].mValue;
+            for(std::size_t i = begin; i < end; ++i)
+            {
+                T value = std::invoke(proj, first[static_cast<std::ranges::range_difference_t<R>>(i)]);
+                if(acc)
+                    acc = std::invoke(op, std::move(*acc), std::move(value));
+                else
+                    acc.emplace(std::move(value));
+            }
+        });
+        partials.resize(loop.num_runners());
+        co_await co_await loop.run();
+        for(auto &partial : partials)
+        {
+            if(partial.mValue)
+                init = std::invoke(op, std::move(init), std::move(*partial.mValue));
+        }
+        co_return std::move(init);
+    }
+}
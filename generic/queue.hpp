@@ -3,9 +3,9 @@
 #include <awaiter/task.hpp>
 #include <generic/condition_variable.hpp>
 #include <utils/cacheline.hpp>
+#include <utils/concurrent_queue.hpp>
 #include <utils/non_void_helper.hpp>
 #include <utils/ring_queue.hpp>
-#include <utils/spin_mutex.hpp>
 
 namespace zh_async
 {
@@ -47,6 +47,7 @@ namespace zh_async
                 co_await co_await mReady.wait(kNonFullMask);
             }
             mReady.notify_one(kNonEmptyMask);
+            co_return {};
         }
 
         Task<Expected<T>> pop()
@@ -61,83 +62,171 @@ namespace zh_async
                 co_await co_await mReady.wait(kNonEmptyMask);
             }
         }
+
+        /*
+            批量操作：一次移动多个元素，按实际移动的个数唤醒对端，整批只通知一次
+            try_ 版本不等待，返回实际移动的个数
+        */
+        std::size_t try_push_bulk(std::span<T> values)
+        {
+            std::size_t count = mQueue.push_bulk(values);
+            if(count)
+                mReady.notify_n(count, kNonEmptyMask);
+            return count;
+        }
+
+        std::size_t try_pop_bulk(std::output_iterator<T> auto out, std::size_t maxCount)
+        {
+            std::size_t count = mQueue.pop_bulk(out, maxCount);
+            if(count)
+                mReady.notify_n(count, kNonFullMask);
+            return count;
+        }
+
+        // 把 values 全部放入队列（元素被移动走），队列满时等待
+        Task<Expected<>> push_bulk(std::span<T> values)
+        {
+            while(true)
+            {
+                values = values.subspan(try_push_bulk(values));
+                if(values.empty())
+                    co_return {};
+                co_await co_await mReady.wait(kNonFullMask);
+            }
+        }
+
+        // 等到队列非空，再一次取出最多 maxCount 个元素写入 out，返回取出的个数
+        Task<Expected<std::size_t>> pop_bulk(std::output_iterator<T> auto out, std::size_t maxCount)
+        {
+            if(maxCount == 0)[[unlikely]]
+                co_return 0;
+            while(true)
+            {
+                if(std::size_t count = try_pop_bulk(out, maxCount))
+                    co_return count;
+                co_await co_await mReady.wait(kNonEmptyMask);
+            }
+        }
     };
 
+    /*
+        多生产者多消费者的异步队列，底层是无锁有界环形队列（Vyukov 序号槽）
+            入队出队只是各自位置上的一次 CAS，生产者和消费者互不阻塞
+            只有队列满（push）或空（pop）时才挂到条件变量的等待队列上，
+            条件在等待队列锁内复查，跨线程也不会丢失唤醒；没有等待者时通知只读一次计数
+    */
     template<class T>
     struct alignas(hardware_destructive_interference_size) ConcurrentQueue
     {
     private:
-        RingQueue<T> mQueue;
+        ConcurrentRingQueue<T> mQueue;
         ConditionVariable mReady;
-        SpinMutex mMutex;
 
         static constexpr ConditionVariable::Mask kNonEmptyMask = 1;
         static constexpr ConditionVariable::Mask kNonFullMask = 2;
 
+        bool notFull() const noexcept
+        { return mQueue.size() < mQueue.max_size(); }
+
     public:
         explicit ConcurrentQueue(std::size_t maxSize = 0): mQueue(maxSize) {}
 
+        // 重置队列容量（向上取整到 2 的幂），仅能在没有其他线程访问时调用
         void set_max_size(std::size_t maxSize)
-            { mQueue.set_max_size(amxSize); }
+            { mQueue.set_max_size(maxSize); }
 
         ConcurrentQueue(ConcurrentQueue &&) = delete;
 
         std::optional<T> try_pop()
         {
-            std::unique_lock(mMutex);
-            bool wasFull = mQueue.full();
             auto value = mQueue.pop();
-            lock.unlock();
-            if(value && wasFull)
+            if(value)
                 mReady.notify_one(kNonFullMask);
             return value;
         }
 
         bool try_push(T &&value)
         {
-            std::unique_lock lock(mMutex);
-            bool wasEmpty = Queue.empty();
-            bool ok = mQueue.push(std::move(value));
-            lock.unnlock();
-            if(o && wasEmpty)
-                mReady.notify_one(kNonEmptyMask);
-            return ok;
+            if(!mQueue.push(std::move(value)))
+                return false;
+            mReady.notify_one(kNonEmptyMask);
+            return true;
         }
 
         Task<Expected<T>> pop()
         {
-            std::unique_lock lock(mMutex);
-            while(mQueue.empty())
+            while(true)
+            {
+                if(auto value = mQueue.pop())
+                {
+                    mReady.notify_one(kNonFullMask);
+                    co_return std::move(*value);
+                }
+                co_await co_await mReady.wait(kNonEmptyMask, [this] {
+                    return !mQueue.empty();
+                });
+            }
+        }
+
+        Task<Expected<>> push(T value)
+        {
+            while(!mQueue.push(std::move(value)))
             {
-                lock.unlock();
-                co_await co_await mReady.wait(kNonEmptyMask);
-                lock.lock();
+                co_await co_await mReady.wait(kNonFullMask, [this] {
+                    return notFull();
+                });
             }
-            bool wasFull = mQueue.full();
-            T value = mQueue.pop_unchecked();
-            lock.unlock();
-            if(wasFull)
-                mReady.notify_one(kNonFullMask);
-            co_return std::move(value);
+            mReady.notify_one(kNonEmptyMask);
+            co_return {};
         }
 
-        Task<Expected<>> push(T value) 
+        /*
+            批量操作：一次 CAS 占下或取走连续的一段槽位，按实际移动的个数唤醒对端，整批只通知一次
+            try_ 版本不等待，返回实际移动的个数
+        */
+        std::size_t try_push_bulk(std::span<T> values)
         {
-        std::unique_lock lock(mMutex);
-        while (mQueue.full()) 
+            std::size_t count = mQueue.push_bulk(values);
+            if(count)
+                mReady.notify_n(count, kNonEmptyMask);
+            return count;
+        }
+
+        std::size_t try_pop_bulk(std::output_iterator<T> auto out, std::size_t maxCount)
         {
-            lock.unlock();
-            co_await co_await mReady.wait(kNonFullMask);
-            lock.lock();
+            std::size_t count = mQueue.pop_bulk(out, maxCount);
+            if(count)
+                mReady.notify_n(count, kNonFullMask);
+            return count;
         }
-        bool wasEmpty = mQueue.empty();
-        mQueue.push_unchecked(std::move(value));
-        lock.unlock();
-        if (wasEmpty) {
-            mReady.notify_one(kNonEmptyMask);
+
+        // 把 values 全部放入队列（元素被移动走），队列满时等待
+        Task<Expected<>> push_bulk(std::span<T> values)
+        {
+            while(true)
+            {
+                values = values.subspan(try_push_bulk(values));
+                if(values.empty())
+                    co_return {};
+                co_await co_await mReady.wait(kNonFullMask, [this] {
+                    return notFull();
+                });
+            }
         }
-        co_return {};
-    }
 
+        // 等到队列非空，再一次取出最多 maxCount 个元素写入 out，返回取出的个数
+        Task<Expected<std::size_t>> pop_bulk(std::output_iterator<T> auto out, std::size_t maxCount)
+        {
+            if(maxCount == 0)[[unlikely]]
+                co_return 0;
+            while(true)
+            {
+                if(std::size_t count = try_pop_bulk(out, maxCount))
+                    co_return count;
+                co_await co_await mReady.wait(kNonEmptyMask, [this] {
+                    return !mQueue.empty();
+                });
+            }
+        }
     };
 } //namepsace zh_async
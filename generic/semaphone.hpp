@@ -2,20 +2,24 @@
 #include <std.hpp>
 #include <awaiter/task.hpp>
 #include <generic/condition_variable.hpp>
-#include <platform/futex.hpp>
 #include <utils/non_void_helper.hpp>
 
 namespace zh_async
 {
-    //自实现信号量
+    /*
+        自实现信号量
+        计数本身是原子变量，获取和释放在不需要等待时只有一次 CAS
+        需要等待时挂在 ConditionVariable 的用户态等待队列上，条件在队列锁内复查，跨线程也不会丢失唤醒
+    */
     struct Semaphone
     {
     private:
-        FutexAtomic<std::uint32_t> mCounter;//当前资源计数
+        std::atomic<std::uint32_t> mCounter;//当前资源计数
         std::uint32_t const mMaxCount;      //信号量最大值
+        ConditionVariable mReady;
 
-        static constexpr std::uint32_t kAcquireMask = 1;    //
-        static constexpr std::uint32_t kReleaseMask = 2;    //
+        static constexpr ConditionVariable::Mask kAcquireMask = 1;    // 等待计数大于 0 的获取者
+        static constexpr ConditionVariable::Mask kReleaseMask = 2;    // 等待计数小于上限的释放者
 
     public:
         explicit Semaphone(std::uint32_t maxCount,std::uint32_t initialCount)
@@ -33,37 +37,41 @@ namespace zh_async
         //尝试获取一个资源
         Task<Expected<>> acquire()
         {
-            std::uint32_t count = mCounter.load(std::memory_order_relaxed);
-            do
+            while(true)
             {
-                while(count == 0)
+                std::uint32_t count = mCounter.load(std::memory_order_relaxed);
+                while(count != 0)
                 {
-                    co_await co_await futex_wait(&mCounter,count,kAcquireMask);
-                    count = mCounter.load(std::memory_order_relaxed);
+                    if(mCounter.compare_exchange_weak(count,count - 1,std::memory_order_acq_rel,std::memory_order_relaxed))
+                    {
+                        mReady.notify_one(kReleaseMask);
+                        co_return {};
+                    }
                 }
-            } while(mCounter.compare_exchange_weak(count,count - 1,std::memory_order_acq_rel,std::memory_order_relaxed));
-
-            futex_notify(&mCounter,1,kReleaseMask);
-            co_return {};
+                co_await co_await mReady.wait(kAcquireMask,[this]{
+                    return mCounter.load(std::memory_order_relaxed) != 0;
+                });
+            }
         }
 
         //尝试释放一个资源
         Task<Expected<>> release()
         {
-            std::uint32_t count = mCounter.load(std::memory_order_relaxed);
-            do
+            while(true)
             {
-               while(count == mMaxCount)
-               {
-                    co_await co_await futex_wait(&mCounter,count,kReleaseMask);
-                    count = mCounter.load(std::memory_order_relaxed);
-               }
-            } while (mCounter.compare_exchange_weak(count, count + 1,
-                                                std::memory_order_acq_rel,
-                                                std::memory_order_relaxed));
-            futex_notify(&mCounter, 1, kAcquireMask);
-            co_return {};
-            
+                std::uint32_t count = mCounter.load(std::memory_order_relaxed);
+                while(count != mMaxCount)
+                {
+                    if(mCounter.compare_exchange_weak(count,count + 1,std::memory_order_acq_rel,std::memory_order_relaxed))
+                    {
+                        mReady.notify_one(kAcquireMask);
+                        co_return {};
+                    }
+                }
+                co_await co_await mReady.wait(kReleaseMask,[this]{
+                    return mCounter.load(std::memory_order_relaxed) != mMaxCount;
+                });
+            }
         }
     };
-} //namespace zh_async
\ No newline at end of file
+} //namespace zh_async
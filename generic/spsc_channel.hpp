@@ -0,0 +1,197 @@
+#pragma once
+#include <std.hpp>
+#include <awaiter/task.hpp>
+#include <generic/condition_variable.hpp>
+#include <utils/cacheline.hpp>
+
+namespace zh_async
+{
+    /*
+        单生产者单消费者的异步通道，适合 pipe_stream、每个连接的写队列这类一对一的流水线
+        同一时刻只能有一个协程（或线程）推入、一个协程（或线程）取出，两端可以在不同的 IOContext / 线程上
+            读写位置各自独占缓存行，只由所属的一端写入，另一端用 acquire 读取，不需要 CAS 和锁
+            每一端缓存对端的位置，只有按缓存看起来已满/已空时才重新读取对端的缓存行
+            批量操作写完一批元素后只发布一次位置、只唤醒一次
+        队列为空时 pop 挂起，已满时 push 挂起；等待用带 pred 的条件变量，跨线程也不会丢失唤醒
+        容量会向上取整到 2 的幂
+    */
+    template <class T>
+    struct SpscChannel
+    {
+    private:
+        std::unique_ptr<T[]> mBuffer;
+        std::size_t mMask;
+        ConditionVariable mReady;
+
+        static constexpr ConditionVariable::Mask kNonEmptyMask = 1;
+        static constexpr ConditionVariable::Mask kNonFullMask = 2;
+
+        // 消费者一端：读位置和缓存的写位置
+        alignas(hardware_destructive_interference_size) std::atomic<std::size_t> mHead{0};
+        std::size_t mTailCache = 0;
+        // 生产者一端：写位置和缓存的读位置
+        alignas(hardware_destructive_interference_size) std::atomic<std::size_t> mTail{0};
+        std::size_t mHeadCache = 0;
+
+        // 生产者调用：返回从 tail 起可以写入的槽位数，至多 want 个
+        std::size_t writable(std::size_t tail, std::size_t want) noexcept
+        {
+            std::size_t free = mMask + 1 - (tail - mHeadCache);
+            if(free < want)
+            {
+                mHeadCache = mHead.load(std::memory_order_acquire);
+                free = mMask + 1 - (tail - mHeadCache);
+            }
+            return std::min(free, want);
+        }
+
+        // 消费者调用：返回从 head 起可以读取的元素数，至多 want 个
+        std::size_t readable(std::size_t head, std::size_t want) noexcept
+        {
+            std::size_t avail = mTailCache - head;
+            if(avail < want)
+            {
+                mTailCache = mTail.load(std::memory_order_acquire);
+                avail = mTailCache - head;
+            }
+            return std::min(avail, want);
+        }
+
+        bool notFull() const noexcept
+        {
+            return mTail.load(std::memory_order_relaxed) -
+                   mHead.load(std::memory_order_acquire) <= mMask;
+        }
+
+        bool notEmpty() const noexcept
+        {
+            return mTail.load(std::memory_order_acquire) !=
+                   mHead.load(std::memory_order_relaxed);
+        }
+
+    public:
+        explicit SpscChannel(std::size_t size)
+            : mBuffer(std::make_unique<T[]>(std::bit_ceil(std::max<std::size_t>(size, 1)))),
+              mMask(std::bit_ceil(std::max<std::size_t>(size, 1)) - 1) {}
+
+        SpscChannel(SpscChannel &&) = delete;
+
+        [[nodiscard]] std::size_t max_size() const noexcept
+        { return mMask + 1; }
+
+        // 另一端并发操作时只是一个近似值
+        [[nodiscard]] std::size_t size() const noexcept
+        {
+            std::size_t head = mHead.load(std::memory_order_acquire);
+            std::size_t tail = mTail.load(std::memory_order_acquire);
+            return tail - head;
+        }
+
+        [[nodiscard]] bool empty() const noexcept
+        { return size() == 0; }
+
+        // 以下 push 系列只能由生产者调用
+        bool try_push(T &&value)
+        {
+            std::size_t tail = mTail.load(std::memory_order_relaxed);
+            if(!writable(tail, 1))
+                return false;
+            mBuffer[tail & mMask] = std::move(value);
+            mTail.store(tail + 1, std::memory_order_release);
+            mReady.notify_one(kNonEmptyMask);
+            return true;
+        }
+
+        // 压入 values 开头的元素（移动走），返回压入的个数
+        std::size_t try_push_bulk(std::span<T> values)
+        {
+            std::size_t tail = mTail.load(std::memory_order_relaxed);
+            std::size_t count = writable(tail, values.size());
+            if(count == 0)
+                return 0;
+            for(std::size_t i = 0; i < count; ++i)
+                mBuffer[(tail + i) & mMask] = std::move(values[i]);
+            mTail.store(tail + count, std::memory_order_release);
+            mReady.notify_one(kNonEmptyMask);
+            return count;
+        }
+
+        Task<Expected<>> push(T value)
+        {
+            while(!try_push(std::move(value)))
+            {
+                co_await co_await mReady.wait(kNonFullMask, [this] {
+                    return notFull();
+                });
+            }
+            co_return {};
+        }
+
+        // 把 values 全部推入通道，通道满时等待
+        Task<Expected<>> push_bulk(std::span<T> values)
+        {
+            while(true)
+            {
+                values = values.subspan(try_push_bulk(values));
+                if(values.empty())
+                    co_return {};
+                co_await co_await mReady.wait(kNonFullMask, [this] {
+                    return notFull();
+                });
+            }
+        }
+
+        // 以下 pop 系列只能由消费者调用
+        std::optional<T> try_pop()
+        {
+            std::size_t head = mHead.load(std::memory_order_relaxed);
+            if(!readable(head, 1))
+                return std::nullopt;
+            std::optional<T> value(std::move(mBuffer[head & mMask]));
+            mHead.store(head + 1, std::memory_order_release);
+            mReady.notify_one(kNonFullMask);
+            return value;
+        }
+
+        // 取出最多 maxCount 个元素依次写入 out，返回取出的个数
+        std::size_t try_pop_bulk(std::output_iterator<T> auto out, std::size_t maxCount)
+        {
+            std::size_t head = mHead.load(std::memory_order_relaxed);
+            std::size_t count = readable(head, maxCount);
+            if(count == 0)
+                return 0;
+            for(std::size_t i = 0; i < count; ++i)
+                *out++ = std::move(mBuffer[(head + i) & mMask]);
+            mHead.store(head + count, std::memory_order_release);
+            mReady.notify_one(kNonFullMask);
+            return count;
+        }
+
+        Task<Expected<T>> pop()
+        {
+            while(true)
+            {
+                if(auto value = try_pop())
+                    co_return std::move(*value);
+                co_await co_await mReady.wait(kNonEmptyMask, [this] {
+                    return notEmpty();
+                });
+            }
+        }
+
+        // 等到通道非空，再一次取出最多 maxCount 个元素写入 out，返回取出的个数
+        Task<Expected<std::size_t>> pop_bulk(std::output_iterator<T> auto out, std::size_t maxCount)
+        {
+            if(maxCount == 0)[[unlikely]]
+                co_return 0;
+            while(true)
+            {
+                if(std::size_t count = try_pop_bulk(out, maxCount))
+                    co_return count;
+                co_await co_await mReady.wait(kNonEmptyMask, [this] {
+                    return notEmpty();
+                });
+            }
+        }
+    };
+} //namespace zh_async
@@ -1,187 +1,170 @@
 #include <awaiter/task.hpp>
 #include <generic/thread_pool.hpp>
+#include <generic/cancel.hpp>
 #include <platform/futex.hpp>
 
 namespace zh_async
 {
-   /*
-      线程池的核心，封装了一个 std::jthread 和与之配套的同步机制
-   */
-    struct Thread_pool::Thread
+    namespace
     {
-        std::function<void()> mTask;   // 任务队列
-        std::condition_variable mCV;   // 条件变量
-        std::mutex mMutex;             // 互斥锁
-        Thread_pool *mPool;            // 指向父线程池的回指针
-        std::jthread mThread;          // C++20引入的现代线程类
+        // 当前线程所属的线程池和编号，线程池内部提交任务时优先放进自己的队列
+        thread_local Thread_pool *currentPool = nullptr;
+        thread_local std::size_t currentWorker = 0;
+    }
+
+    Thread_pool::Thread_pool(std::size_t numWorkers, std::size_t queueSize,
+                             bool workStealing)
+    {
+        if(numWorkers == 0)
+            numWorkers = std::max<std::size_t>(1, std::thread::hardware_concurrency());
+        std::size_t numQueues = workStealing ? numWorkers : 1;
+        mQueues.reserve(numQueues);
+        for(std::size_t i = 0; i < numQueues; ++i)
+            mQueues.push_back(std::make_unique<ConcurrentRingQueue<ThreadPoolJob *>>(
+                std::max<std::size_t>(1, queueSize)));
+        mWorkers.reserve(numWorkers);
+        for(std::size_t i = 0; i < numWorkers; ++i)
+            mWorkers.emplace_back([this, i] { workerMain(i); });
+    }
 
-         ~Thread()
-         {
-            mThread.request_stop();
-            mCV.notify_one();
-            mThread.join();
-         }
+    Thread_pool::~Thread_pool()
+    {
+        // 工作线程会先把队列里剩下的任务做完再退出
+        mStopping.store(true, std::memory_order_seq_cst);
+        mWakeSeq.fetch_add(1, std::memory_order_seq_cst);
+        (void)futex_notify_sync(&mWakeSeq);
+        mWorkers.clear();
+    }
 
-         /*
-            线程的主循环
-         */
-         void startMain(std::stop_token stop)
-         {
-            // 1、循环条件
-            // 当线程池析构时，这个循环就会自动退出
-            while(!stop.stop_requested())[[likely]]
+    /*
+         先取自己的队列，开启工作窃取时再依次尝试其他线程的队列
+    */
+    ThreadPoolJob *Thread_pool::takeJob(std::size_t self)
+    {
+        std::size_t n = mQueues.size();
+        for(std::size_t i = 0; i < n; ++i)
+        {
+            if(auto job = mQueues[(self + i) % n]->pop())
             {
-               // 2、常规流程：锁住
-                std::unique_lock lock(mMutex);
-                mCV.wait(lock,[&]{return mTask != nullptr || stop.stop_requested();});
-                // 3、检查是否需要退出
-                if(stop.stop_requested())[[unlikely]] { return; }
-               // 4、取出任务并执行
-                auto task = std::exchange(mTask,nullptr);
-                lock.unlock();   // 执行任务前释放锁
-                task();
-                lock.lock();     // 任务完成，更新线程池状态
-                mTask = nullptr;
-                std::unique_lock workingLock(mPool->mWorkingMutex);
-                // 从工作表中移除
-                mPool->mWorkingThreads.remove(this);
-                workingLock.unlock();
-                std::lock_guard freeLock(mPool->mFreeMutex);
-                mPool->mFreeThreads.push_back(this);
+                notifySpace();
+                return *job;
             }
-         }
-
-         explicit Thread(Thread_pool *pool)
-         {
-            mPool = pool;
-            mThread = std::jthread([this](std::stop_token stop){ startMain(stop); });
-         }
-
-         Thread(Thread &&) = delete;
+        }
+        return nullptr;
+    }
 
-         void workOn(std::function<void()> func)
-         {
-            std::lock_guard lock(mMutex);
-            mTask =std::move(func);
-            mCV.notify_one();
-         }
-    };
+    // 从 start 开始依次尝试每个队列，全满时返回 false
+    bool Thread_pool::tryPush(std::size_t start, ThreadPoolJob *job)
+    {
+        std::size_t n = mQueues.size();
+        for(std::size_t i = 0; i < n; ++i)
+        {
+            if(mQueues[(start + i) % n]->push(std::move(job)))[[likely]]
+                return true;
+        }
+        return false;
+    }
 
-    /*
-         这个函数负责将任务func分配给一个线程
-         通过分别锁定 mFreeMutex, mThreadsMutex, mWorkingMutex，最大限度地减少了锁竞争，提高了并发性能
-    */
-    Thread_pool::Thread *Thread_pool::submitJob(std::function<void()> func)
+    void Thread_pool::wakeOne()
     {
-        std::unique_lock freeLock(mFreeMutex);
-        // 如果没有空闲线程
-        if(mFreeThreads.empty())
+        // 与工作线程的 mIdle.fetch_add 配对：要么这里看到有线程在休眠，要么对方重新检查时看到新任务
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if(mIdle.load(std::memory_order_relaxed) != 0)
         {
-            freeLock.unlock();
-            std::unique_lock threadsLock(mThreadsMutex);
-            //list 保证插入后元素的指针和引用永远不会失效
-            //所以在这里创建线程并存入其他链表是安全的
-            Thread *newthread = &mThreads.emplace_back(this);
-            threadsLock.unlock();
-            newthread->workOn(std::move(func));
-            std::lock_guard workingLock(mWorkingMutex);
-            mWorkingThreads.push_back(newthread);
-            return newthread;
+            mWakeSeq.fetch_add(1, std::memory_order_release);
+            (void)futex_notify_sync(&mWakeSeq, 1);
         }
-        // 如果由空闲线程
-        else
+    }
+
+    void Thread_pool::notifySpace()
+    {
+        // 与提交者的 mFullWaiters.fetch_add 配对：要么这里看到有提交者在休眠，要么对方重新尝试时看到空位
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if(mFullWaiters.load(std::memory_order_relaxed) != 0)[[unlikely]]
         {
-            Thread *FreeThread = std::move(mFreeThreads.front());
-            mFreeThreads.pop_front();
-            freeLock.unlock();
-            FreeThread->workOn(std::move(func));
-            std::lock_guard workingLock(mWorkingMutex);
-            mWorkingThreads.push_back(FreeThread);
-            return FreeThread;
+            mSpaceSeq.fetch_add(1, std::memory_order_release);
+            (void)futex_notify_sync(&mSpaceSeq, 1);
         }
     }
 
     /*
-         RawRun：桥接了同步的线程和异步的协程
+         线程的主循环：有任务就执行，没有任务就登记为空闲并在 futex 上休眠
     */
-
-    // 无取消版本
-    Task<Expected<>> Thread_pool::rawRun(std::function<void()> func)
+    void Thread_pool::workerMain(std::size_t self)
     {
-      auto ready = std::make_shared<FutexAtomic<bool>>(false);
-      std::exception_ptr ep;
-      submitJob([ready,func = std::move(func),&ep]() mutable{
-         try{
-            func();
-         }catch(...){
-            ep = std::current_exception();
-         }
-         // 释放
-         ready->store(true,std::memory_order_release);
-         (void)futex_notify_sync(ready.get());
-      });
-      // 获取
-      while(ready->load(std::memory_order_acquire) == false){
-         // 使用 co_await futex_wait 挂起直到工作线程完成任务并唤醒它
-         (void)co_await futex_wait(ready.get(),false);
-      }
-
-      if(ep)[[unlikely]]
-         std::rethrow_exception(ep);
-      co_return {};
-    };
-
-    // 带取消版本
-    Task<Expected<>> Thread_pool::rawRun(std::function<void(std::stop_token)> func,
-                                    CancelToken cancel)
-      {
-         auto ready = std::make_shared<FutexAtomic<bool>>(false);
-         std::stop_source stop;
-         bool stopped = false;
-         std::exception_ptr ep;
-         submitJob([ready, func = std::move(func), stop = stop.get_token(),
-               &ep]() mutable {
-        try {
-            func(stop);
-        } catch (...) {
-            ep = std::current_exception();
+        currentPool = this;
+        currentWorker = self;
+        while(true)
+        {
+            if(auto job = takeJob(self))[[likely]]
+            {
+                job->mInvoke(job);
+                continue;
+            }
+            std::uint32_t seq = mWakeSeq.load(std::memory_order_acquire);
+            mIdle.fetch_add(1, std::memory_order_seq_cst);
+            // 登记后必须再检查一次，否则可能错过登记前一刻提交的任务
+            if(auto job = takeJob(self))
+            {
+                mIdle.fetch_sub(1, std::memory_order_relaxed);
+                job->mInvoke(job);
+                continue;
+            }
+            if(mStopping.load(std::memory_order_acquire))[[unlikely]]
+            {
+                mIdle.fetch_sub(1, std::memory_order_relaxed);
+                return;
+            }
+            // 期间有人唤醒过（mWakeSeq 已变化）时会立即返回
+            (void)futex_wait_sync(&mWakeSeq, seq);
+            mIdle.fetch_sub(1, std::memory_order_relaxed);
         }
-        ready->store(true, std::memory_order_release);
-        (void)futex_notify_sync(ready.get());
-    });
+    }
 
+    /*
+         这个函数负责将任务job放入队列：
+         在工作线程内提交时放进自己的队列，否则轮流选择一个队列
+         所有队列都满时：工作线程自己提交的任务直接就地执行（否则可能等待自己而死锁），
+         外部线程则唤醒工作线程，在 mSpaceSeq 上休眠到有任务被取走为止，不空转
+    */
+    void Thread_pool::submitJob(ThreadPoolJob *job)
     {
-      CancelCallback _(cancel,[&]{
-         stopped = true;
-         stop.request_stop();
-      });
-      while(ready->load(std::memory_order_acquire) == false){
-         (void)co_await futex_wait(ready.get(),false);
-      }
+        std::size_t start = currentPool == this
+                                ? currentWorker
+                                : mNextQueue.fetch_add(1, std::memory_order_relaxed);
+        while(!tryPush(start, job))[[unlikely]]
+        {
+            if(currentPool == this)
+            {
+                job->mInvoke(job);
+                return;
+            }
+            std::uint32_t seq = mSpaceSeq.load(std::memory_order_acquire);
+            mFullWaiters.fetch_add(1, std::memory_order_seq_cst);
+            // 登记后必须再试一次，否则可能错过登记前一刻腾出的空位
+            if(tryPush(start, job))
+            {
+                mFullWaiters.fetch_sub(1, std::memory_order_relaxed);
+                break;
+            }
+            // 队列满说明工作线程有活干，通常都醒着，保险起见再叫一次
+            wakeOne();
+            // 期间有任务被取走（mSpaceSeq 已变化）时会立即返回
+            (void)futex_wait_sync(&mSpaceSeq, seq);
+            mFullWaiters.fetch_sub(1, std::memory_order_relaxed);
+        }
+        wakeOne();
     }
 
-    if(ep)[[unlikely]]
-      std::rethrow_exception(ep);
-
-      if(stopped)
-         co_return std::errc::operation_canceled;
-
-      co_return {};
-      }
-
    std::size_t Thread_pool::threads_count()
    {
-      std::lock_guard lock(mThreadsMutex);
-      return mThreads.size();
+      return mWorkers.size();
    }
 
-   std::size_t Thread_pool::threads_count()
+   std::size_t Thread_pool::working_threads_count()
    {
-      std::lock_guard lock(mWorkingMutex);
-      return mWorkingThreads.size();
+      std::size_t idle = mIdle.load(std::memory_order_relaxed);
+      return idle < mWorkers.size() ? mWorkers.size() - idle : 0;
    }
 
-   Thread_pool::Thread_pool() = default;
-   Thread_pool::~Thread_pool() = default;
-
-} //namespace zh_async
\ No newline at end of file
+} //namespace zh_async
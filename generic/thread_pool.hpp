@@ -1,29 +1,136 @@
 #pragma once
 #include <std.hpp>
 #include <awaiter/task.hpp>
-#include <generic/condition_variable.hpp>
+#include <generic/cancel.hpp>
 #include <generic/io_context.hpp>
-#include <utils/spin_mutex.hpp>
+#include <utils/cacheline.hpp>
+#include <utils/concurrent_queue.hpp>
 
 namespace zh_async
 {
+    /*
+        线程池队列里的任务只是一个函数指针，具体的可调用对象和完成通知由派生类提供
+        Thread_pool 自己的等待者把它嵌在协程帧里，提交和完成都不需要分配内存
+    */
+    struct ThreadPoolJob
+    {
+        void (*mInvoke)(ThreadPoolJob *job) noexcept;
+    };
+
     struct Thread_pool
     {
     private:
-        struct Thread;
+        /*
+            固定数量的工作线程 + 有界无锁队列：
+            提交任务只是一次无锁入队，只有在有线程休眠时才需要一次 futex 唤醒
+            开启工作窃取时每个线程各有一个队列，线程内提交的任务放到自己的队列，空闲时去偷别的队列
+        */
+        std::vector<std::unique_ptr<ConcurrentRingQueue<ThreadPoolJob *>>> mQueues;
+        std::vector<std::jthread> mWorkers;
+        // 外部提交时轮流选择队列，分散入队竞争
+        alignas(hardware_destructive_interference_size) std::atomic<std::size_t> mNextQueue{0};
+        // 休眠中（或正准备休眠）的线程数，提交任务时据此决定是否需要唤醒
+        alignas(hardware_destructive_interference_size) std::atomic<std::uint32_t> mIdle{0};
+        // 每次唤醒时递增，工作线程在此 futex 上休眠
+        alignas(hardware_destructive_interference_size) std::atomic<std::uint32_t> mWakeSeq{0};
+        std::atomic<bool> mStopping{false};
+        // 因所有队列都满而休眠的外部提交者数，工作线程取走任务时据此决定是否需要唤醒
+        alignas(hardware_destructive_interference_size) std::atomic<std::uint32_t> mFullWaiters{0};
+        // 队列腾出空位时递增，外部提交者在此 futex 上休眠
+        alignas(hardware_destructive_interference_size) std::atomic<std::uint32_t> mSpaceSeq{0};
+
+        ThreadPoolJob *takeJob(std::size_t self);
+        bool tryPush(std::size_t start, ThreadPoolJob *job);
+        void wakeOne();
+        void notifySpace();
+        void workerMain(std::size_t self);
+
+        /*
+            把可调用对象连同完成通知一起放在等待者里，co_await 时等待者就在协程帧中：
+                入队的只是等待者的地址，不做类型擦除，也不需要堆分配
+                工作线程执行完后通过 IOContext::post 把协程送回原来的线程（MSG_RING 或收件箱 + eventfd），
+                协程不必再提交一个 io_uring futex 等待，工作线程也不必发 futex 唤醒
+        */
+        template <class F>
+        struct JobAwaiter : ThreadPoolJob
+        {
+            Thread_pool *mPool;
+            F mFunc;
+            IOContext *mContext = nullptr;
+            std::coroutine_handle<> mPrevious;
+            std::exception_ptr mException;
+
+            JobAwaiter(Thread_pool *pool, F func)
+                : ThreadPoolJob{&JobAwaiter::invoke}, mPool(pool), mFunc(std::move(func)) {}
+
+            bool await_ready() const noexcept { return false; }
 
-        SpinMutex mWorkingMutex;
-        std::list<Thread *> mWorkingThreads;    // 工作线程列表
-        SpinMutex mFreeMutex;
-        std::list<Thread *> mFreeThreads;       // 空闲线程列表
-        SpinMutex mThreadsMutex;
-        std::list<Thread> mThreads;              // 线程存储池
+            void await_suspend(std::coroutine_handle<> coroutine)
+            {
+                // 完成后要 post 回等待者的 IOContext，没有 IOContext 的线程（比如工作线程自己）不能在这里等待
+                if(!IOContext::instance)[[unlikely]]
+                    throw std::logic_error("Thread_pool job awaited on a thread without an IOContext");
+                mPrevious = coroutine;
+                mContext = IOContext::instance;
+                mContext->expectPost();
+                mPool->submitJob(this);
+            }
 
-        Thread *submitJob(std::function<void()> func);
+            void await_resume()
+            {
+                mContext->postReceived();
+                if(mException)[[unlikely]]
+                    std::rethrow_exception(mException);
+            }
+
+            static void invoke(ThreadPoolJob *job) noexcept
+            {
+                auto self = static_cast<JobAwaiter *>(job);
+                try {
+                    self->mFunc();
+                } catch (...) {
+                    self->mException = std::current_exception();
+                }
+                // post 之后协程随时可能恢复并销毁等待者，不能再访问 self
+                self->mContext->post(self->mPrevious);
+            }
+        };
 
     public:
-        Task<Expected<>> rawRun(std::function<void()> func);
-        Task<Expected<>> rawRun(std::function<void(std::stop_token)> func,CancelToken cancel);
+        // 提交一个任务，job 必须存活到 mInvoke 被调用为止，可以在任意线程调用
+        void submitJob(ThreadPoolJob *job);
+
+        /*
+            RawRun：桥接了同步的线程和异步的协程，不取函数的返回值
+            可调用对象按原类型存放在协程帧里的等待者中，不经过 std::function，完成后由工作线程直接 post 回来
+        */
+        // 无取消版本
+        template <std::invocable F>
+        Task<Expected<>> rawRun(F func)
+        {
+            co_await JobAwaiter(this, std::move(func));
+            co_return {};
+        }
+
+        // 带取消版本：取消只是请求停止，仍然要等工作线程执行完
+        template <std::invocable<std::stop_token> F>
+        Task<Expected<>> rawRun(F func, CancelToken cancel)
+        {
+            std::stop_source stop;
+            bool stopped = false;
+            {
+                CancelCallback _(cancel, [&] {
+                    stopped = true;
+                    stop.request_stop();
+                });
+                co_await JobAwaiter(this, [&func, token = stop.get_token()] {
+                    func(token);
+                });
+            }
+            if(stopped)
+                co_return std::errc::operation_canceled;
+            co_return {};
+        }
 
         // run() 无取消版本
         auto run(std::invocable auto func)
@@ -32,13 +139,11 @@ namespace zh_async
         {
             // 储存函数执行结果
             std::optional<Avoid<std::invoke_result_t<decltype(func)>>> res;
-            // 将函数打爆成lambda，传递给rawRun,并等待co_await完成
-            co_await co_await rawRun([&res,func = std::move(func)]() mutable{
-                res = (func(),Void());
+            // 结果和函数都留在本协程帧里，工作线程通过引用访问
+            co_await JobAwaiter(this, [&res, &func] {
+                res = (func(), Void());
             });
-            // 如果 res 为空，说明任务取消了，否则返回结果
-            if(!res)[[unlikely]] co_return std::errc::operation_canceled;
-
+            // 函数抛出的异常已在 co_await 处重新抛出，走到这里时 res 一定有值
             co_return std::move(*res);
         }
 
@@ -49,14 +154,19 @@ namespace zh_async
             Expected<std::invoke_result_t<decltype(func), std::stop_token>>> 
         {
         std::optional<Avoid<std::invoke_result_t<decltype(func), std::stop_token>>> res;
-        auto e = co_await rawRun(
-            [&res, func = std::move(func)](std::stop_token stop) mutable {
-                res = (func(stop), Void());
+        std::stop_source stop;
+        bool stopped = false;
+        {
+            // 取消只是请求停止，仍然要等工作线程执行完才能离开，它还引用着本协程帧
+            CancelCallback _(cancel, [&] {
+                stopped = true;
+                stop.request_stop();
             });
-        if (e.has_error()) 
-            co_return CO_ASYNC_ERROR_FORWARD(e);
-        
-        if (!res) 
+            co_await JobAwaiter(this, [&res, &func, token = stop.get_token()] {
+                res = (func(token), Void());
+            });
+        }
+        if (stopped || !res) 
             co_return std::errc::operation_canceled;
         
         co_return std::move(*res);
@@ -72,7 +182,10 @@ namespace zh_async
         std::size_t threads_count() ;
         std::size_t working_threads_count() ;
 
-        Thread_pool();
+        // numWorkers 为 0 时使用硬件线程数，queueSize 是每个任务队列的容量
+        explicit Thread_pool(std::size_t numWorkers = 0,
+                             std::size_t queueSize = 1024,
+                             bool workStealing = false);
         ~Thread_pool();
         Thread_pool &operator=(Thread_pool &&) = delete;
     };
@@ -4,6 +4,8 @@
 #include <generic/cancel.hpp>
 #include <generic/generic_io.hpp>
 #include <generic/io_context.hpp>
+#include <platform/error_handling.hpp>
+#include <platform/platform_io.hpp>
 /*
     在这里封装了睡眠操作
 */
@@ -18,9 +20,37 @@ namespace zh_async
          co_return co_await GenericIOContext::TimerNode::Awaiter(expires);
     }
 
+    /*
+        由 io_uring 在内核里计时的睡眠：提交一个 IORING_TIMEOUT_ABS 的超时操作，
+        到期时间是绝对的 CLOCK_MONOTONIC 时间点（即 steady_clock），与事件循环何时被唤醒无关
+        等待期间不占用用户态的计时器，事件循环没有别的事情时可以一直睡到内核完成这个操作
+        取消语义与 co_sleep 相同：通过 cancelGuard 发出异步取消，返回 operation_canceled
+    */
+    inline Task<Expected<>>
+    co_sleep_kernel(std::chrono::steady_clock::time_point expires)
+    {
+        struct __kernel_timespec ts = timePointToKernelTimespec(expires);
+        int res = co_await UringOp()
+                      .prep_timeout(&ts, 0, IORING_TIMEOUT_ABS)
+                      .cancelGuard(co_await co_cancel);
+        // 超时正常到期时以 -ETIME 完成
+        if(res == -ETIME || res >= 0)[[likely]]
+            co_return {};
+        co_return std::errc(-res);
+    }
+
+    inline Task<Expected<>>
+    co_sleep_kernel(std::chrono::steady_clock::duration timeout)
+    {
+        return co_sleep_kernel(std::chrono::steady_clock::now() + timeout);
+    }
+
+    // 按当前 IOContext 的 kernelTimers 选项决定走用户态计时器还是内核计时
     inline Task<Expected<>>
     co_sleep(std::chrono::steady_clock::time_point expires)
     {
+        if(IOContext::instance && IOContext::instance->kernelTimers())
+            co_return co_await co_sleep_kernel(expires);
         auto task = coSleep(expires);
         CancelCallback _(co_await co_cancel, [p = &task.promise()]{
             p->doCancel();
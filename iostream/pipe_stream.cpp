@@ -1,6 +1,6 @@
 #include <awaiter/task.hpp>
 #include <generic/condition_variable.hpp>
-#include <generic/queue.hpp>
+#include <generic/spsc_channel.hpp>
 #include <iostream/pipe_stream.hpp>
 #include <iostream/stream_base.hpp>
 #include <platform/fs.hpp>
@@ -10,9 +10,10 @@
 #endif
 namespace zh_async
 {
+    // 管道只有一个读端和一个写端
     struct PipeStreamBuffer
     {
-        ConcurrentQueue<std::string> mChunks{64};
+        SpscChannel<std::string> mChunks{64};
     };
 
     struct IPipeStream : Stream
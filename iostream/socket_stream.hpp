@@ -11,6 +11,9 @@ namespace zh_async
     struct SocketStream : Stream
     {
         Task<Expected<std::size_t>> raw_read(std::span<char> buffer)override{
+            if(mRecv)
+                co_return co_await mRecv->read(buffer,mTimeout,co_await co_cancel);
+
             auto ret = co_await socket_read(mFile,buffer,mTimeout,co_await co_cancel);
 
             if(ret == std::make_error_code(std::errc::operation_canceled))
@@ -28,7 +31,30 @@ namespace zh_async
             co_return ret;
         }
 
-        SocketHandle release()noexcept{
+        bool raw_buffer_on_demand()const noexcept override{
+            return mRecv && !mRecv->ready();
+        }
+
+        Task<Expected<>> raw_wait_readable()override{
+            co_return co_await mRecv->wait(mTimeout,co_await co_cancel);
+        }
+
+        /*
+            交出套接字，多发接收已经收进内核挑选缓冲区、还没被读走的数据追加到 buffered，不会随 mRecv 一起丢弃
+            不传 buffered 时有积压数据会抛出 std::logic_error，而不是悄悄丢掉
+        */
+        SocketHandle release(String &buffered){
+            if(mRecv){
+                mRecv->drain(buffered);
+                mRecv.reset();
+            }
+            return std::move(mFile);
+        }
+
+        SocketHandle release(){
+            if(mRecv && mRecv->ready())
+                throw std::logic_error("SocketStream::release() would discard received data");
+            mRecv.reset();
             return std::move(mFile);
         }
 
@@ -36,7 +62,14 @@ namespace zh_async
             return mFile;
         }
 
-        explicit SocketStream(SocketHandle file) : mFile(std::move(file)) {}
+        /*
+            multishotRecv 为 true 且内核支持时，读取改走多发接收：数据落在 IOContext 共享的内核挑选缓冲区里，
+            空闲连接不再占用读缓冲，适合大量长连接的场景
+        */
+        explicit SocketStream(SocketHandle file,bool multishotRecv = false) : mFile(std::move(file)) {
+            if(multishotRecv && SocketMultishotRecv::supported())
+                mRecv.emplace(mFile);
+        }
 
         void raw_timeout(std::chrono::steady_clock::duration timeout)override{
             mTimeout = timeout;
@@ -46,6 +79,7 @@ namespace zh_async
     private:
         SocketHandle mFile;
         std::chrono::steady_clock::duration mTimeout = std::chrono::seconds(30);
+        std::optional<SocketMultishotRecv> mRecv;   // 在 mFile 之前析构
     };
 
     inline Task<Expected<OwningStream>>
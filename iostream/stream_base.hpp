@@ -47,6 +47,16 @@ inline constexpr std::size_t kStreamBufferSize = 8192;
             co_return std::errc::not_supported;
         }
 
+        // 数据到达前不需要调用方提供读缓冲时返回 true（如开启多发接收的 SocketStream），
+        // 此时 BorrowedStream 会先归还已读完的缓冲，等 raw_wait_readable 返回后再重新分配
+        virtual bool raw_buffer_on_demand() const noexcept{
+            return false;
+        }
+
+        virtual Task<Expected<>> raw_wait_readable(){
+            co_return {};
+        }
+
         Stream &operator=(Stream &&) = delete;
         virtual ~Stream() = default;
 
@@ -468,6 +478,12 @@ inline constexpr std::size_t kStreamBufferSize = 8192;
 
         Task<Expected<>> fillbuf()
         {
+            if(mInEnd == 0 && mRaw->raw_buffer_on_demand())[[unlikely]]
+            {
+                // 读缓冲已经消费完，空闲期间不持有它，数据真正到达后再分配
+                mInBuffer = ByteBuffer();
+                co_await co_await mRaw->raw_wait_readable();
+            }
             if(!mInBuffer)
                 allocinbuf(kStreamBufferSize);
 
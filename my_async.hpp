@@ -18,8 +18,10 @@
 #include <generic/io_context.hpp>
 #include <generic/io_context_mt.hpp>
 #include <generic/mutex.hpp>
+#include <generic/parallel.hpp>
 #include <generic/queue.hpp>
 #include <generic/semaphone.hpp>
+#include <generic/spsc_channel.hpp>
 #include <generic/thread_pool.hpp>
 #include <generic/timeout.hpp>
 #include <generic/when_any.hpp>
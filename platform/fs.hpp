@@ -45,6 +45,48 @@ protected:
     int mFileNo;
 };
 
+/*
+    固定文件表里的文件（direct descriptor），fileIndex() 是表中的下标而不是 fd
+    对它的操作会自动带上 IOSQE_FIXED_FILE，内核不再查找进程的 fd 表，也不再增减文件引用计数
+    只在创建它的 IOContext 线程上有效，析构时归还槽位
+*/
+struct [[nodiscard]] DirectFileHandle {
+    DirectFileHandle() noexcept : mFileIndex(-1) {}
+
+    explicit DirectFileHandle(int fileIndex) noexcept : mFileIndex(fileIndex) {}
+
+    int fileIndex() const noexcept {
+        return mFileIndex;
+    }
+
+    int releaseFile() noexcept {
+        int ret = mFileIndex;
+        mFileIndex = -1;
+        return ret;
+    }
+
+    explicit operator bool() noexcept {
+        return mFileIndex != -1;
+    }
+
+    DirectFileHandle(DirectFileHandle &&that) noexcept
+        : mFileIndex(that.releaseFile()) {}
+
+    DirectFileHandle &operator=(DirectFileHandle &&that) noexcept {
+        std::swap(mFileIndex, that.mFileIndex);
+        return *this;
+    }
+
+    ~DirectFileHandle() {
+        if (mFileIndex != -1) {
+            PlatformIOContext::instance->releaseFileSlot(mFileIndex);
+        }
+    }
+
+protected:
+    int mFileIndex;
+};
+
 struct FileStat {
     struct statx *getNativeStatx() {
         return &mStatx;
@@ -175,6 +217,29 @@ inline Task<Expected<FileHandle>> fs_openat(FileHandle dir,
     co_return file;
 }
 
+// 把已打开的文件移进固定文件表，原 fd 随 file 一起关闭，表满或内核不支持时返回错误
+inline Expected<DirectFileHandle> fs_register(FileHandle file) {
+    int index = PlatformIOContext::instance->registerFile(file.fileNo());
+    if (index < 0) [[unlikely]] {
+        return std::errc(-index);
+    }
+    return DirectFileHandle(index);
+}
+
+// 打开文件并由内核直接装进固定文件表，不占用进程的 fd
+inline Task<Expected<DirectFileHandle>>
+fs_open_direct(std::filesystem::path path, OpenMode mode, mode_t access = 0644) {
+    int index = PlatformIOContext::instance->allocFileSlot();
+    if (index < 0) [[unlikely]] {
+        co_return std::errc(-index);
+    }
+    DirectFileHandle file(index);
+    co_await expectError(co_await UringOp().prep_openat_direct(
+        AT_FDCWD, path.c_str(), static_cast<int>(mode), access,
+        static_cast<unsigned int>(index)));
+    co_return file;
+}
+
 inline Task<Expected<>> fs_close(FileHandle file) {
     co_await expectError(co_await UringOp().prep_close(file.fileNo()));
     file.releaseFile();
@@ -314,6 +379,41 @@ fs_write(FileHandle &file, std::span<char const> buffer, CancelToken cancel,
     );
 }
 
+inline Task<Expected<std::size_t>>
+fs_read(DirectFileHandle &file, std::span<char> buffer,
+        std::uint64_t offset = static_cast<std::uint64_t>(-1)) {
+    co_return static_cast<std::size_t>(co_await expectError(
+        co_await UringOp().prep_read(file.fileIndex(), buffer, offset).fixed_file()));
+}
+
+inline Task<Expected<std::size_t>>
+fs_write(DirectFileHandle &file, std::span<char const> buffer,
+         std::uint64_t offset = static_cast<std::uint64_t>(-1)) {
+    co_return static_cast<std::size_t>(co_await expectError(
+        co_await UringOp().prep_write(file.fileIndex(), buffer, offset).fixed_file()));
+}
+
+inline Task<Expected<std::size_t>>
+fs_read(DirectFileHandle &file, std::span<char> buffer, CancelToken cancel,
+        std::uint64_t offset = static_cast<std::uint64_t>(-1)) {
+    co_return static_cast<std::size_t>(co_await expectError(
+        co_await UringOp()
+            .prep_read(file.fileIndex(), buffer, offset)
+            .fixed_file()
+            .cancelGuard(cancel)));
+}
+
+inline Task<Expected<std::size_t>>
+fs_write(DirectFileHandle &file, std::span<char const> buffer,
+         CancelToken cancel,
+         std::uint64_t offset = static_cast<std::uint64_t>(-1)) {
+    co_return static_cast<std::size_t>(co_await expectError(
+        co_await UringOp()
+            .prep_write(file.fileIndex(), buffer, offset)
+            .fixed_file()
+            .cancelGuard(cancel)));
+}
+
 inline Task<Expected<>> fs_truncate(FileHandle &file, std::uint64_t size = 0) {
     co_await expectError(co_await UringOp().prep_ftruncate(
         file.fileNo(), static_cast<loff_t>(size)));
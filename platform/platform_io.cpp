@@ -5,6 +5,7 @@
 #include <fcntl.h>
 #include <liburing.h>
 #include <sched.h>
+#include <sys/eventfd.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <sys/wait.h>
@@ -128,13 +129,304 @@ PlatformIOContext::PlatformIOContext() noexcept {
     mRing.ring_fd = -1;
 }
 
-void PlatformIOContext::setup(std::size_t entries) {
-    unsigned int flags = 0;
-#if CO_ASYNC_DIRECT
-    flags |= IORING_SETUP_IOPOLL;
+void PlatformIOContext::setup(std::size_t entries,
+                              RingSetupOptions const &options) {
+    struct io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    // 不开 IORING_SETUP_IOPOLL：轮询环上 eventfd 门铃的读操作和所有网络 / poll 操作都会返回 -EOPNOTSUPP，
+    // CO_ASYNC_DIRECT 只让文件以 O_DIRECT 打开，完成事件照常由中断驱动
+    if (options.sqPoll) {
+        params.flags |= IORING_SETUP_SQPOLL;
+        params.sq_thread_idle =
+            static_cast<__u32>(options.sqPollIdle.count());
+        if (options.sqPollCpu) {
+            params.flags |= IORING_SETUP_SQ_AFF;
+            params.sq_thread_cpu = static_cast<__u32>(*options.sqPollCpu);
+        }
+    }
+    if (options.coopTaskRun) {
+        params.flags |= IORING_SETUP_COOP_TASKRUN;
+    }
+    if (options.singleIssuer || options.deferTaskRun) {
+        params.flags |= IORING_SETUP_SINGLE_ISSUER;
+    }
+    if (options.deferTaskRun) {
+        params.flags |= IORING_SETUP_DEFER_TASKRUN;
+    }
+    // 让内核在有待执行的任务时置位 IORING_SQ_TASKRUN，忙轮询和 needsEnter 据此判断要不要进入内核
+    if (params.flags &
+        (IORING_SETUP_COOP_TASKRUN | IORING_SETUP_DEFER_TASKRUN)) {
+        params.flags |= IORING_SETUP_TASKRUN_FLAG;
+    }
+    if (options.cqEntries) {
+        params.flags |= IORING_SETUP_CQSIZE;
+        params.cq_entries = static_cast<__u32>(*options.cqEntries);
+    }
+    // 不支持的标志内核会返回 EINVAL，按引入的先后逆序逐个去掉重试
+    static constexpr unsigned int kOptionalFlags[] = {
+        IORING_SETUP_DEFER_TASKRUN,
+        IORING_SETUP_SINGLE_ISSUER,
+        IORING_SETUP_COOP_TASKRUN,
+        IORING_SETUP_SQ_AFF,
+        IORING_SETUP_SQPOLL | IORING_SETUP_SQ_AFF,
+    };
+    std::size_t fallback = 0;
+    while (true) {
+        // 失败时内核可能已经改写了 params，每次用副本重试
+        struct io_uring_params tryParams = params;
+        int res = io_uring_queue_init_params(static_cast<unsigned int>(entries),
+                                             &mRing, &tryParams);
+        if (res >= 0) [[likely]] {
+            break;
+        }
+        unsigned int drop = 0;
+        if (res == -EPERM) {
+            // 旧内核上 SQPOLL 需要 CAP_SYS_ADMIN
+            drop = params.flags & (IORING_SETUP_SQPOLL | IORING_SETUP_SQ_AFF);
+        } else if (res == -EINVAL) {
+            while (fallback < std::size(kOptionalFlags) && !drop) {
+                drop = params.flags & kOptionalFlags[fallback++];
+            }
+        }
+        if (!drop) {
+            throw std::system_error(-res, std::system_category());
+        }
+#if ZH_ASYNC_DEBUG
+        std::cerr << "io_uring setup flags 0x" << std::hex << drop << std::dec
+                  << " not supported, falling back\n";
 #endif
-    throwingError(
-        io_uring_queue_init(static_cast<unsigned int>(entries), &mRing, flags));
+        params.flags &= ~drop;
+        // TASKRUN_FLAG 只能和 COOP/DEFER_TASKRUN 一起用，两者都退回后一并去掉
+        if (!(params.flags &
+              (IORING_SETUP_COOP_TASKRUN | IORING_SETUP_DEFER_TASKRUN))) {
+            params.flags &= ~IORING_SETUP_TASKRUN_FLAG;
+        }
+    }
+    mProvidedBufferCount = options.providedBufferCount;
+    mProvidedBufferSize = options.providedBufferSize;
+    mFixedFiles = options.fixedFiles;
+    // 一次收割最多拿到 cq.ring_entries 个完成事件，按此预留就绪列表
+    mReadyCapacity = mRing.cq.ring_entries;
+    mReadyTasks = std::make_unique<std::coroutine_handle<>[]>(mReadyCapacity);
+    // 跨线程投递：优先用 MSG_RING，不支持时退回到收件箱 + eventfd 门铃
+    if (auto *probe = io_uring_get_probe_ring(&mRing)) {
+        mHasMsgRing = io_uring_opcode_supported(probe, IORING_OP_MSG_RING);
+        io_uring_free_probe(probe);
+    }
+    mInbox.set_max_size(mReadyCapacity);
+    // 环里留一个空位区分空和满
+    mLocalPosts.set_max_size(mReadyCapacity + 1);
+#if ZH_ASYNC_STEAL
+    mRunQueue.set_max_size(mReadyCapacity);
+#endif
+    mWakeFd = throwingErrorErrno(eventfd(0, EFD_CLOEXEC));
+    armDoorbell();
+}
+
+void PlatformIOContext::armDoorbell() {
+    struct io_uring_sqe *sqe = getSqeUncounted();
+    io_uring_prep_read(sqe, mWakeFd, &mWakeBuf, sizeof(mWakeBuf), 0);
+    io_uring_sqe_set_data64(sqe, kDoorbellTag);
+}
+
+void PlatformIOContext::ringDoorbell() {
+    // 门铃已经按过且目标尚未处理时，不必重复写 eventfd
+    if (!mWakeRung.exchange(true, std::memory_order_acq_rel)) {
+        std::uint64_t one = 1;
+        (void)!write(mWakeFd, &one, sizeof(one));
+    }
+}
+
+void PlatformIOContext::disableDoorbell(int error) {
+    // 持续性的错误（例如 -EBADF）重新挂上读操作只会立即再次失败，变成空转的忙循环
+    // 关掉门铃后跨线程投递只能靠 MSG_RING，其余投递由 waitEventsFor 限制睡眠时长来发现
+    mDoorbellOff = true;
+    mWakeRung.store(true, std::memory_order_release);
+#if ZH_ASYNC_DEBUG
+    std::cerr << "eventfd doorbell failed: " << std::strerror(-error)
+              << ", falling back to polling the inbox\n";
+#else
+    (void)error;
+#endif
+}
+
+void PlatformIOContext::post(std::coroutine_handle<> coroutine) {
+    PlatformIOContext *sender = instance;
+    // 发送方正在攒一个 SubmitBatch 时不能往它的提交队列里插 SQE（会被串进链里，或者提前把批提交掉），改走收件箱
+    if (sender && sender != this && sender->mHasMsgRing && !sender->mBatch) {
+        // 由发送方的环提交，内核直接在目标环上生成一个 CQE，user_data 即协程地址
+        // 不经过 getSqe 的批处理钩子，发送方自己的完成事件照常计数
+        struct io_uring_sqe *sqe = sender->getSqeUncounted();
+        ++sender->mNumSqesPending;
+        io_uring_prep_msg_ring(sqe, mRing.ring_fd, 0,
+                               reinterpret_cast<__u64>(coroutine.address()) |
+                                   kPostedTag,
+                               0);
+        UringOp::detachSqe(sqe);
+        int res;
+        do {
+            res = io_uring_submit(&sender->mRing);
+        } while (res == -EINTR);
+        throwingError(res);
+        return;
+    }
+    if (sender == this) {
+        // 投递给自己时不需要门铃，waitEventsFor 在睡眠前会先检查本地队列；
+        // 也不能进收件箱：收件箱满时只有本线程能腾出位置，在这里等待就是死锁
+        if (!mLocalOverflow.empty() ||
+            !mLocalPosts.push(std::coroutine_handle<>(coroutine))) [[unlikely]] {
+            mLocalOverflow.push_back(coroutine);
+        }
+        return;
+    }
+    while (!mInbox.push(std::coroutine_handle<>(coroutine))) [[unlikely]] {
+        // 收件箱满了，先叫醒目标线程让它腾出位置
+        ringDoorbell();
+        std::this_thread::yield();
+    }
+    ringDoorbell();
+}
+
+ProvidedBufferRing::ProvidedBufferRing(struct io_uring *ring,
+                                       unsigned short groupId,
+                                       std::size_t count, std::size_t size)
+    : mRing(ring),
+      mSize(size),
+      mCount(static_cast<unsigned int>(std::bit_ceil(count))),
+      mGroupId(groupId) {
+    int res = 0;
+    mBufRing = io_uring_setup_buf_ring(mRing, mCount, mGroupId, 0, &res);
+    if (!mBufRing) {
+        throw std::system_error(-res, std::system_category());
+    }
+    mData = std::make_unique<char[]>(mCount * mSize);
+    for (unsigned int i = 0; i < mCount; ++i) {
+        io_uring_buf_ring_add(mBufRing, mData.get() + i * mSize,
+                              static_cast<unsigned int>(mSize),
+                              static_cast<unsigned short>(i),
+                              io_uring_buf_ring_mask(mCount),
+                              static_cast<int>(i));
+    }
+    io_uring_buf_ring_advance(mBufRing, static_cast<int>(mCount));
+}
+
+ProvidedBufferRing::~ProvidedBufferRing() {
+    io_uring_free_buf_ring(mRing, mBufRing, mCount, mGroupId);
+}
+
+ProvidedBufferRing *PlatformIOContext::providedBuffers() {
+    if (!mProvidedBuffersTried) [[unlikely]] {
+        mProvidedBuffersTried = true;
+        try {
+            mProvidedBuffers = std::make_unique<ProvidedBufferRing>(
+                &mRing, 0, mProvidedBufferCount, mProvidedBufferSize);
+        } catch (std::system_error const &e) {
+            // 5.19 之前的内核没有 buffer ring，调用方退回到自带缓冲区的接收
+            if (e.code() != std::errc::invalid_argument) {
+                throw;
+            }
+        }
+    }
+    return mProvidedBuffers.get();
+}
+
+struct io_uring_sqe *PlatformIOContext::batchSqe() {
+    // 超出预留的个数时提交队列可能已满，再取 SQE 就得中途提交，批会被拆开，链接和 drain 标志也会落到内核已经取走的 SQE 上
+    if (mBatch->mNumOps == mBatch->mReserved) [[unlikely]] {
+        throw std::length_error("SubmitBatch: more operations than reserved");
+    }
+    // 构造时腾出了 mReserved 个空位，批内准备的 SQE 一定拿得到
+    struct io_uring_sqe *sqe = io_uring_get_sqe(&mRing);
+    if (!sqe) [[unlikely]] {
+        throw std::logic_error(
+            "SubmitBatch: reserved submission queue space was taken");
+    }
+    // prep_* 会清空 flags，所以链接标志在下一个 SQE 到来时才补到上一个上，最后一个不带
+    if (mBatch->mLink && mBatch->mLast) {
+        mBatch->mLast->flags |= IOSQE_IO_LINK;
+    }
+    if (!mBatch->mFirst) {
+        mBatch->mFirst = sqe;
+    }
+    mBatch->mLast = sqe;
+    ++mBatch->mNumOps;
+    return sqe;
+}
+
+SubmitBatch::SubmitBatch(std::size_t numOps, bool link, bool drain)
+    : mContext(PlatformIOContext::instance),
+      mReserved(numOps),
+      mLink(link),
+      mDrain(drain) {
+    if (mContext->mBatch) [[unlikely]] {
+        throw std::logic_error("SubmitBatch cannot be nested");
+    }
+    if (numOps > mContext->mRing.sq.ring_entries) [[unlikely]] {
+        throw std::length_error("SubmitBatch larger than the submission queue");
+    }
+    if (io_uring_sq_space_left(&mContext->mRing) < numOps) {
+        mContext->submitPending();
+    }
+    mContext->mBatch = this;
+}
+
+SubmitBatch::~SubmitBatch() {
+    if (mContext->mBatch == this) {
+        close();
+        // 析构函数里不能抛出：提交失败时 SQE 仍留在队列里，事件循环下一轮提交时会再次尝试并照常抛出；
+        // 需要在作用域内处理错误时显式调用 submit()
+        int res;
+        do {
+            res = io_uring_submit(&mContext->mRing);
+        } while (res == -EINTR);
+    }
+}
+
+void SubmitBatch::close() noexcept {
+    mContext->mBatch = nullptr;
+    if (mDrain && mFirst) {
+        mFirst->flags |= IOSQE_IO_DRAIN;
+    }
+    mFirst = mLast = nullptr;
+}
+
+void SubmitBatch::submit() {
+    // 已经提交过，或者已被事件循环提前结束
+    if (mContext->mBatch != this) {
+        return;
+    }
+    close();
+    mContext->submitPending();
+}
+
+void PlatformIOContext::submitPending() {
+    if (mBatch) [[unlikely]] {
+        mBatch->close();
+    }
+    int res;
+    do {
+        res = io_uring_submit(&mRing);
+    } while (res == -EINTR);
+    throwingError(res);
+}
+
+std::size_t PlatformIOContext::drainInbox(std::size_t numTasks) {
+    // 就绪列表装不下的留在队列里，下一轮 waitEventsFor 不会睡眠
+    while (numTasks < mReadyCapacity && !mLocalPosts.empty()) {
+        mReadyTasks[numTasks++] = mLocalPosts.pop_unchecked();
+    }
+    while (numTasks < mReadyCapacity && !mLocalOverflow.empty()) [[unlikely]] {
+        mReadyTasks[numTasks++] = mLocalOverflow.front();
+        mLocalOverflow.pop_front();
+    }
+    while (numTasks < mReadyCapacity) {
+        auto coroutine = mInbox.pop();
+        if (!coroutine) {
+            break;
+        }
+        mReadyTasks[numTasks++] = *coroutine;
+    }
+    return numTasks;
 }
 
 void PlatformIOContext::reserveBuffers(std::size_t nbufs) {
@@ -175,41 +467,102 @@ PlatformIOContext::addBuffers(std::span<std::span<char> const> bufs) {
 }
 
 void PlatformIOContext::reserveFiles(std::size_t nfiles) {
-    auto oldBuf = std::move(mBuffers);
-    mBuffers = std::make_unique<struct iovec[]>(nfiles);
+    if (mNumFiles != mFreeFiles.size()) [[unlikely]] {
+        throw std::logic_error("fixed file table is still in use");
+    }
     if (mCapFiles) {
         throwingError(io_uring_unregister_files(&mRing));
+        mCapFiles = 0;
+    }
+    mNumFiles = 0;
+    mFreeFiles.clear();
+    if (nfiles) {
+        throwingError(io_uring_register_files_sparse(
+            &mRing, static_cast<unsigned int>(nfiles)));
+        mCapFiles = static_cast<unsigned int>(nfiles);
     }
-    mCapFiles = static_cast<unsigned int>(nfiles);
-    std::memcpy(mBuffers.get(), oldBuf.get(), sizeof(struct iovec) * mNumBufs);
-    throwingError(io_uring_register_files_sparse(
-        &mRing, static_cast<unsigned int>(nfiles)));
-    std::vector<__u64> tags(mNumFiles, 0);
-    throwingError(io_uring_register_files_update_tag(&mRing, 0, mFiles.get(),
-                                                     tags.data(), mNumFiles));
+}
+
+bool PlatformIOContext::ensureFileTable() {
+    if (!mCapFiles && !mFilesTried) [[unlikely]] {
+        mFilesTried = true;
+        try {
+            reserveFiles(mFixedFiles);
+        } catch (std::system_error const &e) {
+            // 5.19 之前的内核不支持稀疏注册
+            if (e.code() != std::errc::invalid_argument) {
+                throw;
+            }
+        }
+    }
+    return mCapFiles != 0;
 }
 
 std::size_t PlatformIOContext::addFiles(std::span<int const> files) {
-    if (mNumFiles >= mCapFiles) {
-        reserveBuffers(mCapFiles * 2 + 1);
+    if (!mFreeFiles.empty()) {
+        if (mFreeFiles.size() != mNumFiles) [[unlikely]] {
+            throw std::logic_error("addFiles: fixed file table is fragmented");
+        }
+        // 槽位都已归还，表是空的，从头开始分配
+        mFreeFiles.clear();
+        mNumFiles = 0;
     }
-    auto outP = mFiles.get() + mNumFiles;
-    for (auto const &file: files) {
-        *outP++ = file;
+    if (!ensureFileTable() || mCapFiles - mNumFiles < files.size())
+        [[unlikely]] {
+        throw std::system_error(ENFILE, std::system_category());
     }
-    std::vector<__u64> tags(files.size(), 0);
-    throwingError(io_uring_register_files_update_tag(
-        &mRing, mNumFiles, mFiles.get() + mNumFiles, tags.data(),
+    throwingError(io_uring_register_files_update(
+        &mRing, mNumFiles, files.data(),
         static_cast<unsigned int>(files.size())));
-    size_t ret = mNumFiles;
+    std::size_t ret = mNumFiles;
     mNumFiles += static_cast<unsigned int>(files.size());
     return ret;
 }
 
+int PlatformIOContext::allocFileSlot() {
+    if (!mFreeFiles.empty()) {
+        int index = mFreeFiles.back();
+        mFreeFiles.pop_back();
+        return index;
+    }
+    if (!ensureFileTable()) [[unlikely]] {
+        return -EOPNOTSUPP;
+    }
+    if (mNumFiles == mCapFiles) [[unlikely]] {
+        return -ENFILE;
+    }
+    return static_cast<int>(mNumFiles++);
+}
+
+int PlatformIOContext::registerFile(int fd) {
+    int index = allocFileSlot();
+    if (index < 0) [[unlikely]] {
+        return index;
+    }
+    int res = io_uring_register_files_update(
+        &mRing, static_cast<unsigned int>(index), &fd, 1);
+    if (res < 0) [[unlikely]] {
+        mFreeFiles.push_back(index);
+        return res;
+    }
+    return index;
+}
+
+void PlatformIOContext::releaseFileSlot(int index) {
+    int fd = -1;
+    (void)io_uring_register_files_update(
+        &mRing, static_cast<unsigned int>(index), &fd, 1);
+    mFreeFiles.push_back(index);
+}
+
 PlatformIOContext::~PlatformIOContext() {
+    mProvidedBuffers.reset();
     if (mRing.ring_fd != -1) {
         io_uring_queue_exit(&mRing);
     }
+    if (mWakeFd != -1) {
+        close(mWakeFd);
+    }
 }
 
 thread_local PlatformIOContext *PlatformIOContext::instance;
@@ -219,37 +572,105 @@ bool PlatformIOContext::waitEventsFor(
     // debug(), "wait", this, mNumSqesPending;
     struct io_uring_cqe *cqe;
     struct __kernel_timespec ts, *tsp;
-    if (timeout) {
-        tsp = &(ts = durationToKernelTimespec(*timeout));
+    // 批的所有者在作用域内挂起了，批到此结束，下面照常提交
+    if (mBatch) [[unlikely]] {
+        mBatch->close();
+    }
+    // 收件箱或本地队列里已有投递过来的协程时不要睡眠
+    bool inboxReady = hasLocalPosts() || !mInbox.empty();
+    if (mDoorbellOff && (!timeout || *timeout > kDoorbellOffPoll)) [[unlikely]] {
+        timeout = kDoorbellOffPoll;
+    }
+    if (inboxReady && !needsEnter()) {
+        // 同一线程上的同步原语互相唤醒时只经过本地队列，又没有要提交的 SQE、内核也没有攒着任务，
+        // 此时完全不进入内核，只顺带收割已经到达的完成事件；
+        // 否则即使有协程可以运行也要进一次内核（不阻塞），以免一直投递的协程让 I/O 完成事件饿死
+    } else if (timeout == std::chrono::steady_clock::duration::zero() &&
+               !needsEnter()) {
+        // 只是不阻塞地看一眼：没有要提交的 SQE，内核也没有攒着任务，已完成的事件都在完成队列里了
     } else {
-        tsp = nullptr;
-    }
-    int res = io_uring_submit_and_wait_timeout(&mRing, &cqe, 1, tsp, nullptr);
-    if (res == -ETIME) {
-        return false;
-    } else if (res < 0) [[unlikely]] {
-        if (res == -EINTR) {
-            return false;
+        if (inboxReady) {
+            timeout = std::chrono::steady_clock::duration::zero();
+        }
+        if (timeout) {
+            tsp = &(ts = durationToKernelTimespec(*timeout));
+        } else {
+            tsp = nullptr;
+        }
+        int res =
+            io_uring_submit_and_wait_timeout(&mRing, &cqe, 1, tsp, nullptr);
+        if (res < 0 && res != -ETIME && res != -EINTR) [[unlikely]] {
+            throw std::system_error(-res, std::system_category());
         }
-        throw std::system_error(-res, std::system_category());
     }
-    unsigned head, numGot = 0;
-    std::vector<std::coroutine_handle<>> tasks;
+    unsigned head, numGot = 0, numUncounted = 0;
+    std::size_t numTasks = 0;
+    bool doorbell = false;
+    int doorbellError = 0;
     io_uring_for_each_cqe(&mRing, head, cqe) {
+        // 就绪列表已满时剩余的完成事件留到下一轮再收割
+        if (numTasks == mReadyCapacity) [[unlikely]] {
+            break;
+        }
+        ++numGot;
 #if CO_ASYNC_INVALFIX
         if (cqe->user_data == LIBURING_UDATA_TIMEOUT) [[unlikely]] {
-            ++numGot;
             continue;
         }
 #endif
+        if (cqe->user_data & kPostedTag) [[unlikely]] {
+            // 其他线程通过 MSG_RING 投递过来的协程，没有对应的本地 SQE
+            mReadyTasks[numTasks++] = std::coroutine_handle<>::from_address(
+                reinterpret_cast<void *>(cqe->user_data & ~kPostedTag));
+            ++numUncounted;
+            continue;
+        }
+        if (cqe->user_data == kDoorbellTag) [[unlikely]] {
+            if (cqe->res < 0 && cqe->res != -EINTR && cqe->res != -ECANCELED)
+                [[unlikely]] {
+                doorbellError = cqe->res;
+            } else {
+                doorbell = true;
+            }
+            ++numUncounted;
+            continue;
+        }
+        if (cqe->user_data & kMultishotTag) {
+            // 多发操作只有最后一个 CQE 对应提交时计入的那个 SQE
+            if (cqe->flags & IORING_CQE_F_MORE) {
+                ++numUncounted;
+            }
+            auto *op = reinterpret_cast<UringMultishot *>(cqe->user_data &
+                                                          ~kMultishotTag);
+            if (auto coroutine = op->onCompletion(cqe->res, cqe->flags)) {
+                mReadyTasks[numTasks++] = coroutine;
+            }
+            continue;
+        }
         auto *op = reinterpret_cast<UringOp *>(cqe->user_data);
         op->mRes = cqe->res;
-        tasks.push_back(op->mPrevious);
-        ++numGot;
+        mReadyTasks[numTasks++] = op->mPrevious;
     }
     io_uring_cq_advance(&mRing, numGot);
-    mNumSqesPending -= static_cast<std::size_t>(numGot);
-    for (auto const &task: tasks) {
+    mNumSqesPending -= static_cast<std::size_t>(numGot - numUncounted);
+    if (doorbellError) [[unlikely]] {
+        disableDoorbell(doorbellError);
+    } else if (doorbell) {
+        // 先复位门铃再取收件箱，之后到达的投递会重新按门铃，不会丢失唤醒
+        mWakeRung.exchange(false, std::memory_order_acq_rel);
+        armDoorbell();
+    }
+    numTasks = drainInbox(numTasks);
+#if ZH_ASYNC_STEAL
+    // 逆序压入运行队列：所有者从底部弹出时按完成顺序恢复，窃取者从顶部拿走最新的
+    for (std::size_t i = numTasks; i-- > 0;) {
+        if (!mRunQueue.push(mReadyTasks[i])) [[unlikely]] {
+            mReadyTasks[i].resume(); // 运行队列满了就地恢复
+        }
+    }
+#else
+    // 先推进完成队列再恢复协程，恢复过程中不会重入 waitEventsFor，就绪列表可以安全复用
+    for (auto const &task: std::span(mReadyTasks.get(), numTasks)) {
 #if CO_ASYNC_DEBUG
         if (!task) [[likely]] {
             std::cerr << "null coroutine pushed into task queue\n";
@@ -260,6 +681,7 @@ bool PlatformIOContext::waitEventsFor(
 #endif
         task.resume();
     }
-    return true;
+#endif
+    return numTasks != 0;
 }
 } // namespace co_async
@@ -3,6 +3,8 @@
 #include <awaiter/task.hpp>
 #include <generic/generic_io.hpp>
 #include <platform/error_handling.hpp>
+#include <utils/concurrent_queue.hpp>
+#include <utils/ring_queue.hpp>
 #include <fcntl.h>
 #include <liburing.h>
 #include <sched.h>
@@ -30,6 +32,68 @@ timePointToKernelTimespec(std::chrono::time_point<Clk, Dur> tp) {
     return durationToKernelTimespec(tp.time_since_epoch());
 }
 
+/*
+    io_uring 建环模式，默认全部关闭，与原先的行为一致
+    内核不支持的标志会在 setup 时逐个去掉重试，实际生效的标志可以通过 setupFlags() 查看
+*/
+struct RingSetupOptions {
+    // 由内核线程轮询提交队列，热路径上不再需要 io_uring_enter 系统调用（5.11 之前需要特权）
+    bool sqPoll = false;
+    // 轮询线程空闲多久后进入睡眠，之后的提交需要一次系统调用把它唤醒
+    std::chrono::milliseconds sqPollIdle = std::chrono::milliseconds(1000);
+    // 轮询线程绑定的 CPU
+    std::optional<std::size_t> sqPollCpu = std::nullopt;
+    // 完成事件的任务只在进入内核时执行，不再用 IPI 打断用户态（5.19）
+    bool coopTaskRun = false;
+    // 只有创建环的线程会提交，内核可以省掉提交侧的锁（6.0）
+    bool singleIssuer = false;
+    // 推迟任务到等待完成事件时才执行，隐含 singleIssuer，不能与 sqPoll 同时使用（6.1）
+    bool deferTaskRun = false;
+    // 覆盖完成队列长度，默认是提交队列的两倍
+    std::optional<std::size_t> cqEntries = std::nullopt;
+    // 内核挑选缓冲区的个数（向上取整到 2 的幂）和每块的大小，首次使用多发接收时才创建
+    std::size_t providedBufferCount = 1024;
+    std::size_t providedBufferSize = 4096;
+    // 固定文件表的槽位数，首次分配槽位时注册，之后不能扩容；0 表示不使用
+    std::size_t fixedFiles = 1024;
+};
+
+/*
+    注册给内核的一组定长缓冲区（provided buffer ring，5.19）
+    带 IOSQE_BUFFER_SELECT 的接收操作不再自带缓冲区，数据到达时由内核从中挑一块填入，
+    CQE 的 flags 里带回缓冲区编号，用完后通过 recycle 归还
+    空闲的连接因此不必各自占着一块读缓冲，内存只在数据真正到达时被占用
+*/
+struct ProvidedBufferRing {
+    ProvidedBufferRing(struct io_uring *ring, unsigned short groupId,
+                       std::size_t count, std::size_t size);
+    ProvidedBufferRing(ProvidedBufferRing &&) = delete;
+    ~ProvidedBufferRing();
+
+    unsigned short groupId() const noexcept {
+        return mGroupId;
+    }
+
+    std::span<char> buffer(unsigned short bufId, std::size_t len) const noexcept {
+        return {mData.get() + bufId * mSize, len};
+    }
+
+    void recycle(unsigned short bufId) noexcept {
+        io_uring_buf_ring_add(mBufRing, mData.get() + bufId * mSize,
+                              static_cast<unsigned int>(mSize), bufId,
+                              io_uring_buf_ring_mask(mCount), 0);
+        io_uring_buf_ring_advance(mBufRing, 1);
+    }
+
+private:
+    struct io_uring *mRing;
+    struct io_uring_buf_ring *mBufRing = nullptr;
+    std::unique_ptr<char[]> mData;
+    std::size_t mSize;
+    unsigned int mCount;
+    unsigned short mGroupId;
+};
+
 struct PlatformIOContext {
     [[gnu::cold]] static void schedSetThreadAffinity(size_t cpu);
 
@@ -48,45 +112,207 @@ struct PlatformIOContext {
     waitEventsFor(std::optional<std::chrono::steady_clock::duration> timeout);
 
     [[gnu::hot]] struct io_uring_sqe *getSqe() {
-        struct io_uring_sqe *sqe = io_uring_get_sqe(&mRing);
-        while (!sqe) {
-            int res = io_uring_submit(&mRing);
-            if (res < 0) [[unlikely]] {
-                if (res == -EINTR) {
-                    continue;
-                }
-                throw std::system_error(-res, std::system_category());
-            }
-            sqe = io_uring_get_sqe(&mRing);
+        struct io_uring_sqe *sqe;
+        if (mBatch) [[unlikely]] {
+            sqe = batchSqe();
+        } else {
+            sqe = getSqeUncounted();
         }
         ++mNumSqesPending;
         return sqe;
     }
 
+    /*
+        把协程投递给本上下文所在的线程去恢复，可以在任意线程调用
+        调用方线程自己有 IOContext 且内核支持 IORING_OP_MSG_RING 时，
+            直接往目标环的完成队列里投一个 CQE，目标线程会立即从等待中醒来
+        否则（包括调用方正处在一个未结束的 SubmitBatch 里）放入目标的无锁收件箱，并通过 eventfd 门铃唤醒目标线程
+        投递给本线程自己的上下文时放入不限长度的本地队列：收件箱满时只有本线程能腾出位置，不能在这里等待
+    */
+    void post(std::coroutine_handle<> coroutine);
+
+    /*
+        登记一个稍后会由其他线程 post 回来的协程（例如交给线程池的任务），只能在本线程调用
+        登记期间 hasPendingEvents 为真，事件循环不会因为本地暂时无事可做而提前退出
+        开启工作窃取时被投递回来的协程可能在别的 worker 上恢复，postReceived 因此可以在任意线程调用
+    */
+    void expectPost() noexcept {
+        mNumPostsExpected.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void postReceived() noexcept {
+        mNumPostsExpected.fetch_sub(1, std::memory_order_relaxed);
+    }
+
     PlatformIOContext &operator=(PlatformIOContext &&) = delete;
     [[gnu::cold]] PlatformIOContext() noexcept;
-    [[gnu::cold]] void setup(std::size_t entries);
+    [[gnu::cold]] void setup(std::size_t entries,
+                             RingSetupOptions const &options = {});
     [[gnu::cold]] ~PlatformIOContext();
     static thread_local PlatformIOContext *instance;
 
     void reserveBuffers(std::size_t nbufs);
     std::size_t addBuffers(std::span<std::span<char> const> bufs);
+    /*
+        固定文件表：内核不支持扩容，直接安装进表里的文件（openat_direct 等）也无法重新注册，
+        因此 reserveFiles 只能在没有槽位被占用时调用，默认在首次分配槽位时按 fixedFiles 注册
+        槽位用完即归还到空闲链表复用，分配失败时返回负的错误码，调用方可以退回到普通 fd
+    */
     void reserveFiles(std::size_t nfiles);
+    /*
+        启动时批量注册：files 占用一段连续的槽位，返回第一个槽位的下标
+        连续的槽位只能从未分配过的尾部取：已分配的槽位全部归还时从头开始，
+        空闲链表里还有零散归还的槽位、同时又有槽位在用时抛出 std::logic_error，免得这些槽位再也用不上；
+        尾部不够时抛出 ENFILE。这些槽位之后可以逐个 releaseFileSlot，归还后进入空闲链表
+    */
     std::size_t addFiles(std::span<int const> files);
+    // 分配一个空槽位，供 prep_*_direct 让内核直接把新文件装进去
+    int allocFileSlot();
+    // 把已打开的 fd 注册进一个槽位，之后原 fd 可以关闭
+    int registerFile(int fd);
+    // 清空槽位并归还，表中的引用是最后一个时文件随之关闭
+    void releaseFileSlot(int index);
+
+    // 不进入内核，检查完成队列或收件箱里是否已有事件，供忙轮询使用
+    bool peekEvents() noexcept {
+        // COOP/DEFER_TASKRUN 下完成事件要在本线程进入内核执行任务后才会出现，内核置位 TASKRUN 时才进一次
+        if (IO_URING_READ_ONCE(*mRing.sq.kflags) & IORING_SQ_TASKRUN) {
+            io_uring_get_events(&mRing);
+        }
+        return io_uring_cq_ready(&mRing) != 0 || hasLocalPosts() ||
+               !mInbox.empty();
+    }
+
+    /*
+        把已准备好的 SQE 交给内核，不等待完成
+        事件循环调用时如果还有未结束的 SubmitBatch，说明创建它的协程在批的作用域内挂起了，
+        批在这里结束，已准备的部分照常提交，否则批内的 SQE 永远等不到提交
+    */
+    void submitPending();
+
+    /*
+        不进入内核就收割不到新事件的情况：有待提交的 SQE、完成队列溢出，
+        或者 COOP/DEFER_TASKRUN 下内核攒着要在本线程执行的任务（没有 TASKRUN_FLAG 时无从得知，只能保守地认为有）
+    */
+    bool needsEnter() const noexcept {
+        if (io_uring_sq_ready(&mRing) != 0) {
+            return true;
+        }
+        if (IO_URING_READ_ONCE(*mRing.sq.kflags) &
+            (IORING_SQ_CQ_OVERFLOW | IORING_SQ_TASKRUN)) {
+            return true;
+        }
+        return (mRing.flags &
+                (IORING_SETUP_COOP_TASKRUN | IORING_SETUP_DEFER_TASKRUN)) &&
+               !(mRing.flags & IORING_SETUP_TASKRUN_FLAG);
+    }
+
+    // 本上下文的内核挑选缓冲区，首次调用时创建，内核不支持时返回 nullptr
+    ProvidedBufferRing *providedBuffers();
+
+    // 建环时实际生效的 IORING_SETUP_* 标志
+    unsigned int setupFlags() const noexcept {
+        return mRing.flags;
+    }
 
     std::size_t hasPendingEvents() const noexcept {
-        return mNumSqesPending != 0;
+        return mNumSqesPending != 0 ||
+               mNumPostsExpected.load(std::memory_order_relaxed) != 0 ||
+               hasLocalPosts() || !mInbox.empty();
     }
 
+#if ZH_ASYNC_STEAL
+    /*
+        开启工作窃取时，waitEventsFor 只把就绪的协程放进本地运行队列，不直接恢复
+        所有者通过 popReady 依次恢复，空闲的 worker 通过 stealReady 从队列顶部偷走积压的协程
+    */
+    std::optional<std::coroutine_handle<>> popReady() {
+        return mRunQueue.pop();
+    }
+
+    std::optional<std::coroutine_handle<>> stealReady() {
+        return mRunQueue.steal();
+    }
+
+    std::size_t numReady() const noexcept {
+        return mRunQueue.size();
+    }
+#endif
+
 private:
+    // user_data 的特殊取值，与 UringOp 指针区分开（协程帧和 UringOp 至少按 8 字节对齐）
+    static constexpr __u64 kPostedTag = 1;   // 低位为 1：MSG_RING 投递过来的协程地址
+    static constexpr __u64 kDoorbellTag = 2; // eventfd 门铃上的读操作
+    static constexpr __u64 kMultishotTag = 4; // 第 2 位为 1：UringMultishot 对象的地址
+
+    friend struct UringMultishot;
+    friend struct SubmitBatch;
+
+    [[gnu::hot]] struct io_uring_sqe *getSqeUncounted() {
+        struct io_uring_sqe *sqe = io_uring_get_sqe(&mRing);
+        while (!sqe) {
+            int res = io_uring_submit(&mRing);
+            if (res < 0) [[unlikely]] {
+                if (res == -EINTR) {
+                    continue;
+                }
+                throw std::system_error(-res, std::system_category());
+            }
+            sqe = io_uring_get_sqe(&mRing);
+        }
+        return sqe;
+    }
+
+    struct io_uring_sqe *batchSqe();
+    void armDoorbell();
+    void ringDoorbell();
+    void disableDoorbell(int error);
+    std::size_t drainInbox(std::size_t numTasks);
+
+    bool hasLocalPosts() const noexcept {
+        return !mLocalPosts.empty() || !mLocalOverflow.empty();
+    }
+
     struct io_uring mRing;
     std::size_t mNumSqesPending = 0;
+    std::atomic<std::size_t> mNumPostsExpected{0};
+    // 常驻的就绪协程列表，容量等于完成队列长度，收割完成事件时不再分配内存
+    std::unique_ptr<std::coroutine_handle<>[]> mReadyTasks;
+    std::size_t mReadyCapacity = 0;
+    // 跨线程投递用的收件箱和门铃，门铃上的读操作不计入 mNumSqesPending
+    ConcurrentRingQueue<std::coroutine_handle<>> mInbox;
+    /*
+        本线程投递给自己的协程，只在本线程访问
+        固定容量的环和就绪列表一样长，同一线程上的同步原语互相唤醒时投递不分配内存；
+        环满时才放进溢出队列，溢出队列非空期间的投递也放进去，保持先进先出
+    */
+    RingQueue<std::coroutine_handle<>> mLocalPosts;
+    std::deque<std::coroutine_handle<>> mLocalOverflow;
+    int mWakeFd = -1;
+    std::uint64_t mWakeBuf = 0;
+    std::atomic<bool> mWakeRung{false};
+    // 门铃读操作出错后不再使用，睡眠上限改为 kDoorbellOffPoll，靠轮询发现收件箱里的投递
+    bool mDoorbellOff = false;
+    static constexpr std::chrono::milliseconds kDoorbellOffPoll{10};
+    bool mHasMsgRing = false;
+    struct SubmitBatch *mBatch = nullptr;
+    std::unique_ptr<ProvidedBufferRing> mProvidedBuffers;
+    bool mProvidedBuffersTried = false;
+    std::size_t mProvidedBufferCount = 0;
+    std::size_t mProvidedBufferSize = 0;
+#if ZH_ASYNC_STEAL
+    WorkStealingDeque<std::coroutine_handle<>> mRunQueue;
+#endif
     std::unique_ptr<struct iovec[]> mBuffers;
     unsigned int mNumBufs = 0;
     unsigned int mCapBufs = 0;
-    std::unique_ptr<int[]> mFiles;
-    unsigned int mNumFiles = 0;
+    bool ensureFileTable();
+
+    std::vector<int> mFreeFiles;    // 归还的槽位
+    unsigned int mNumFiles = 0;     // 曾经分配过的最高槽位
     unsigned int mCapFiles = 0;
+    std::size_t mFixedFiles = 0;
+    bool mFilesTried = false;
 };
 
 struct [[nodiscard]] UringOp {
@@ -144,9 +370,20 @@ private:
 
 public:
     void startDetach() {
+        detachSqe(mSqe);
+    }
+
+    // 让一个不经过 UringOp 准备的 SQE 也以不等待结果的方式完成
+    static void detachSqe(struct io_uring_sqe *sqe) {
         static thread_local UringOp detachedOp{DoNotConstruct{}};
         detachedOp.mPrevious = std::noop_coroutine();
-        io_uring_sqe_set_data(mSqe, &detachedOp);
+        io_uring_sqe_set_data(sqe, &detachedOp);
+    }
+
+    // 把 prep_* 里的 fd 当作固定文件表的下标，必须在 prep_* 之后调用
+    UringOp &&fixed_file() && {
+        mSqe->flags |= IOSQE_FIXED_FILE;
+        return std::move(*this);
     }
 
     UringOp &&prep_nop() && {
@@ -339,6 +576,11 @@ public:
         return std::move(*this);
     }
 
+    UringOp &&prep_cancel64(__u64 user_data, int flags) && {
+        io_uring_prep_cancel64(mSqe, user_data, flags);
+        return std::move(*this);
+    }
+
     UringOp &&prep_cancel_fd(int fd, unsigned int flags) && {
         io_uring_prep_cancel_fd(mSqe, fd, flags);
         return std::move(*this);
@@ -396,6 +638,12 @@ public:
         return std::move(*this);
     }
 
+    UringOp &&prep_msg_ring(int fd, unsigned int len, __u64 data,
+                            unsigned int flags) && {
+        io_uring_prep_msg_ring(mSqe, fd, len, data, flags);
+        return std::move(*this);
+    }
+
     UringOp &&prep_futex_wake(uint32_t *futex, uint64_t val, uint64_t mask,
                               uint32_t futex_flags, unsigned int flags) && {
         io_uring_prep_futex_wake(mSqe, futex, val, mask, futex_flags, flags);
@@ -422,4 +670,73 @@ public:
     // }
 };
 
+/*
+    多发操作的基类：一次提交会陆续产生多个 CQE（多发接收、多发 accept 等）
+    提交时 user_data 为 this | kMultishotTag，每个 CQE 都回调 onCompletion，
+    返回需要恢复的协程，没有则返回空句柄
+    不带 IORING_CQE_F_MORE 的 CQE 是这次提交的最后一个事件，之后对象才可以被销毁
+*/
+struct UringMultishot {
+    virtual std::coroutine_handle<> onCompletion(int res,
+                                                 unsigned int flags) = 0;
+
+    __u64 userData() const noexcept {
+        return reinterpret_cast<__u64>(this) | PlatformIOContext::kMultishotTag;
+    }
+
+    // 取一个 SQE 并把完成事件路由回本对象，计入未完成的操作直到最后一个 CQE
+    struct io_uring_sqe *prepSqe() {
+        struct io_uring_sqe *sqe = PlatformIOContext::instance->getSqe();
+        io_uring_sqe_set_data64(sqe, userData());
+        return sqe;
+    }
+
+protected:
+    UringMultishot() = default;
+    UringMultishot(UringMultishot &&) = delete;
+    ~UringMultishot() = default;
+};
+
+/*
+    批量提交：作用域内准备的 SQE 不会因为提交队列满而被拆开，离开作用域（或调用 submit）时由一次 io_uring_enter 交给内核
+    构造时先腾出 numOps 个空位，numOps 不能超过提交队列长度；批内最多准备 numOps 个 SQE，再多取一个抛出 std::length_error
+    批的作用域内不应挂起：创建批的协程挂起后事件循环会提前结束这个批并提交已准备的部分，之后的 SQE 按普通方式提交
+    link 为 true 时批内的操作串成一条链，前一个失败后面的以 -ECANCELED 结束
+    drain 为 true 时批内第一个操作等之前提交的所有操作完成后才开始
+    每个操作的结果照旧通过各自的 UringOp 等待获得，例如向很多连接广播同一条消息：
+        {
+            SubmitBatch batch(subscribers.size());
+            for (auto &sock: subscribers) {
+                co_spawn(publish(sock, message)); // 运行到 co_await UringOp 处挂起，SQE 留在批里
+            }
+        } // 一次系统调用全部提交
+*/
+struct SubmitBatch {
+    explicit SubmitBatch(std::size_t numOps, bool link = false,
+                         bool drain = false);
+    SubmitBatch(SubmitBatch &&) = delete;
+    ~SubmitBatch();
+
+    // 提交批内的操作，之后再准备的 SQE 回到普通的提交方式
+    void submit();
+
+    std::size_t size() const noexcept {
+        return mNumOps;
+    }
+
+private:
+    friend PlatformIOContext;
+
+    // 让 getSqe 回到普通的提交方式，并补上 drain 标志，不提交
+    void close() noexcept;
+
+    PlatformIOContext *mContext;
+    struct io_uring_sqe *mFirst = nullptr;
+    struct io_uring_sqe *mLast = nullptr;
+    std::size_t mNumOps = 0;
+    std::size_t mReserved;
+    bool mLink;
+    bool mDrain;
+};
+
 } // namespace zh_async
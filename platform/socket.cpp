@@ -1,5 +1,6 @@
 #include <arpa/inet.h>  
 #include <generic/cancel.hpp>  // 取消功能
+#include <generic/timeout.hpp>  // 多发 accept 的退避等待
 #include <platform/error_handling.hpp>  // 错误处理功能
 #include <platform/platform_io.hpp>  // 平台输入输出功能
 #include <platform/socket.hpp> 
@@ -325,6 +326,172 @@ namespace zh_async
         co_return sock;  // 返回套接字句柄
     }
 
+    /*
+        多发 accept 的状态放在堆上，生成器提前销毁时变为孤儿：
+        异步取消 accept，之后到达的连接直接关闭，最后一个 CQE 到达时释放
+        消费者跟不上时积压的连接达到 kMaxPending 就取消多发，剩下的留在内核的监听队列里，取完后再重新提交
+    */
+    struct MultishotAcceptState final : UringMultishot {
+        static constexpr std::size_t kMaxPending = 256;
+
+        int mFd;
+        std::vector<int> mAccepted;    // 新连接的 fd，或负的错误码
+        std::size_t mIndex = 0;
+        std::coroutine_handle<> mWaiter;
+        bool mArmed = false;
+        bool mThrottled = false;       // 因积压过多取消了多发，等最后一个 CQE
+        bool mCanceled = false;
+        bool mOrphaned = false;
+
+        explicit MultishotAcceptState(int fd) : mFd(fd) {}
+
+        bool ready() const noexcept {
+            return mIndex != mAccepted.size();
+        }
+
+        int pop() noexcept {
+            int res = mAccepted[mIndex++];
+            if (mIndex == mAccepted.size()) {
+                mAccepted.clear();
+                mIndex = 0;
+            }
+            return res;
+        }
+
+        void arm() {
+            struct io_uring_sqe *sqe = prepSqe();
+            io_uring_prep_multishot_accept(sqe, mFd, nullptr, nullptr, 0);
+            mArmed = true;
+        }
+
+        std::coroutine_handle<> takeWaiter() noexcept {
+            return std::exchange(mWaiter, nullptr);
+        }
+
+        std::coroutine_handle<> onCompletion(int res,
+                                             unsigned int flags) override {
+            if (!(flags & IORING_CQE_F_MORE)) {
+                mArmed = false;
+            }
+            if (mOrphaned) {
+                if (res >= 0) {
+                    close(res);
+                }
+                if (!mArmed) {
+                    delete this;
+                }
+                return nullptr;
+            }
+            // 限流发出的取消以 -ECANCELED 结束多发，不是错误
+            if (!(mThrottled && res == -ECANCELED)) {
+                mAccepted.push_back(res);
+            }
+            if (!mArmed) {
+                mThrottled = false;
+            } else if (!mThrottled && mAccepted.size() - mIndex >= kMaxPending) {
+                mThrottled = true;
+                UringOp().prep_cancel64(userData(), 0).startDetach();
+            }
+            return takeWaiter();
+        }
+
+        void orphan() {
+            mOrphaned = true;
+            mWaiter = nullptr;
+            while (ready()) {
+                if (int res = pop(); res >= 0) {
+                    close(res);
+                }
+            }
+            if (!mArmed) {
+                delete this;
+                return;
+            }
+            UringOp().prep_cancel64(userData(), 0).startDetach();
+        }
+
+        struct Awaiter {
+            MultishotAcceptState *mState;
+
+            bool await_ready() const noexcept {
+                return mState->ready();
+            }
+
+            void await_suspend(std::coroutine_handle<> coroutine) noexcept {
+                mState->mWaiter = coroutine;
+            }
+
+            void await_resume() const noexcept {}
+        };
+    };
+
+    Task<GeneratorResult<SocketHandle, Expected<>>>
+    listener_accept_multishot(SocketListener &listener) {
+        auto *state = new MultishotAcceptState(listener.fileNo());
+        Finally _orphan([state] { state->orphan(); });
+        CancelToken cancel = co_await co_cancel;
+        CancelCallback _cancel(cancel, [state] {
+            if (auto coroutine = state->takeWaiter()) {
+                state->mCanceled = true;
+                coroutine.resume();
+            }
+        });
+        bool accepted = false;
+        while (true) {
+            // 限流结束的多发只带回一个 -ECANCELED，醒来时可能仍然没有连接，重新提交后接着等
+            while (!state->ready()) {
+                if (!state->mArmed) {
+                    state->arm();
+                }
+                co_await MultishotAcceptState::Awaiter{state};
+                if (state->mCanceled) [[unlikely]] {
+                    co_return std::errc::operation_canceled;
+                }
+            }
+            int res = state->pop();
+            if (res >= 0) [[likely]] {
+                accepted = true;
+                co_yield SocketHandle(res);
+                continue;
+            }
+            switch (res) {
+            case -ECONNABORTED:
+            case -EPROTO:
+            case -EPERM:
+            case -EINTR:
+                // 对端在握手后立即断开等，只影响这一个连接
+                continue;
+            case -EMFILE:
+            case -ENFILE:
+            case -ENOBUFS:
+            case -ENOMEM: {
+                // 资源耗尽时内核会结束多发，立刻重新提交只会空转，退避一下等其他连接释放
+                auto slept = co_await co_sleep(std::chrono::milliseconds(10));
+                if (slept.has_error()) [[unlikely]] {
+                    co_return slept.error();
+                }
+                continue;
+            }
+            case -EINVAL:
+                if (!accepted) {
+                    goto oneshot;
+                }
+                [[fallthrough]];
+            default:
+                co_return std::errc(-res);
+            }
+        }
+    oneshot:
+        // 内核不认识多发 accept，逐个提交
+        while (true) {
+            auto sock = co_await listener_accept(listener, cancel);
+            if (sock.has_error()) [[unlikely]] {
+                co_return sock.error();
+            }
+            co_yield std::move(*sock);
+        }
+    }
+
     // 异步写入数据到套接字的函数
     Task<Expected<std::size_t>> socket_write(SocketHandle &sock,
                                              std::span<char const> buf) {
@@ -461,8 +628,324 @@ namespace zh_async
             );
     }
 
+    // 把套接字移进固定文件表
+    Expected<DirectSocketHandle> socket_register(SocketHandle sock) {
+        int index = PlatformIOContext::instance->registerFile(sock.fileNo());
+        if (index < 0) [[unlikely]] {
+            return std::errc(-index);
+        }
+        return DirectSocketHandle(index);
+    }
+
+    // 接受连接并由内核直接装进固定文件表
+    Task<Expected<DirectSocketHandle>>
+    listener_accept_direct(SocketListener &listener) {
+        int index = PlatformIOContext::instance->allocFileSlot();
+        if (index < 0) [[unlikely]] {
+            co_return std::errc(-index);
+        }
+        DirectSocketHandle sock(index);
+        co_await expectError(co_await UringOp().prep_accept_direct(
+            listener.fileNo(), nullptr, nullptr, 0,
+            static_cast<unsigned int>(index)));
+        co_return sock;
+    }
+
+    Task<Expected<std::size_t>> socket_write(DirectSocketHandle &sock,
+                                             std::span<char const> buf) {
+        co_return static_cast<std::size_t>(co_await expectError(
+            co_await UringOp().prep_send(sock.fileIndex(), buf, 0).fixed_file()));
+    }
+
+    Task<Expected<std::size_t>> socket_read(DirectSocketHandle &sock,
+                                            std::span<char> buf) {
+        co_return static_cast<std::size_t>(co_await expectError(
+            co_await UringOp().prep_recv(sock.fileIndex(), buf, 0).fixed_file()));
+    }
+
+    Task<Expected<std::size_t>>
+    socket_write(DirectSocketHandle &sock, std::span<char const> buf,
+                 std::chrono::steady_clock::duration timeout, CancelToken cancel) {
+        auto ts = durationToKernelTimespec(timeout);
+        co_return static_cast<std::size_t>(co_await expectError(
+            co_await UringOp::link_ops(
+                UringOp().prep_send(sock.fileIndex(), buf, 0).fixed_file(),
+                UringOp().prep_link_timeout(&ts, IORING_TIMEOUT_BOOTTIME))
+                .cancelGuard(cancel)));
+    }
+
+    Task<Expected<std::size_t>>
+    socket_read(DirectSocketHandle &sock, std::span<char> buf,
+                std::chrono::steady_clock::duration timeout, CancelToken cancel) {
+        auto ts = durationToKernelTimespec(timeout);
+        co_return static_cast<std::size_t>(co_await expectError(
+            co_await UringOp::link_ops(
+                UringOp().prep_recv(sock.fileIndex(), buf, 0).fixed_file(),
+                UringOp().prep_link_timeout(&ts, IORING_TIMEOUT_BOOTTIME))
+                .cancelGuard(cancel)));
+    }
+
     // 异步关闭套接字的函数
     Task<Expected<>> socket_shutdown(SocketHandle &sock, int how) {
         co_return expectError(co_await UringOp().prep_shutdown(sock.fileNo(), how));  // 准备关闭操作
     }
-}
\ No newline at end of file
+
+    /*
+        多发接收的状态放在堆上，与 SocketMultishotRecv 分离：
+        对象销毁时内核可能还没交回最后一个 CQE，此时状态变为孤儿，等接收和定时器都结束后自行释放
+    */
+    struct SocketMultishotRecv::State final : UringMultishot {
+        // 一段到达的数据，res > 0 为数据长度，0 为对端关闭，负数为错误码
+        struct Chunk {
+            int res;
+            unsigned short bufId;
+        };
+
+        // 等待超时用的内核定时器，完成事件同样路由回状态对象
+        struct Timer final : UringMultishot {
+            State *mState;
+
+            std::coroutine_handle<> onCompletion(int, unsigned int) override {
+                return mState->onTimer();
+            }
+        };
+
+        int mFd;
+        ProvidedBufferRing *mBuffers;
+        std::vector<Chunk> mChunks;     // 空闲连接上不分配
+        std::size_t mChunkIndex = 0;
+        std::size_t mChunkOffset = 0;
+        std::coroutine_handle<> mWaiter;
+        std::chrono::steady_clock::time_point mDeadline;
+        struct __kernel_timespec mTimerTs;
+        Timer mTimer;
+        bool mArmed = false;
+        bool mTimerArmed = false;
+        bool mTimerCanceling = false;
+        bool mTimedOut = false;
+        bool mCanceled = false;
+        bool mOrphaned = false;
+
+        State(int fd, ProvidedBufferRing *buffers)
+            : mFd(fd), mBuffers(buffers) {
+            mTimer.mState = this;
+        }
+
+        bool ready() const noexcept {
+            return mChunkIndex != mChunks.size();
+        }
+
+        Chunk &front() noexcept {
+            return mChunks[mChunkIndex];
+        }
+
+        void popFront() noexcept {
+            mChunkOffset = 0;
+            if (++mChunkIndex == mChunks.size()) {
+                mChunks.clear(); // 保留容量，下一段数据到达时不再分配
+                mChunkIndex = 0;
+            }
+        }
+
+        void arm() {
+            struct io_uring_sqe *sqe = prepSqe();
+            io_uring_prep_recv_multishot(sqe, mFd, nullptr, 0, 0);
+            sqe->flags |= IOSQE_BUFFER_SELECT;
+            sqe->buf_group = mBuffers->groupId();
+            mArmed = true;
+        }
+
+        void armTimer(std::chrono::steady_clock::duration timeout) {
+            mTimerTs = durationToKernelTimespec(timeout);
+            struct io_uring_sqe *sqe = mTimer.prepSqe();
+            io_uring_prep_timeout(sqe, &mTimerTs, 0, 0);
+            mTimerArmed = true;
+        }
+
+        // 撤销还在计时的定时器，取消的 CQE 回到 onTimer 时清除 mTimerArmed
+        void cancelTimer() {
+            if (mTimerArmed && !mTimerCanceling) {
+                UringOp().prep_cancel64(mTimer.userData(), 0).startDetach();
+                mTimerCanceling = true;
+            }
+        }
+
+        std::coroutine_handle<> takeWaiter() noexcept {
+            return std::exchange(mWaiter, nullptr);
+        }
+
+        // 接收和定时器都已结束的孤儿状态由最后一个 CQE 释放
+        bool reapOrphan() {
+            if (mOrphaned && !mArmed && !mTimerArmed) {
+                delete this;
+                return true;
+            }
+            return false;
+        }
+
+        std::coroutine_handle<> onCompletion(int res,
+                                             unsigned int flags) override {
+            if (!(flags & IORING_CQE_F_MORE)) {
+                mArmed = false;
+            }
+            if (flags & IORING_CQE_F_BUFFER) {
+                auto bufId =
+                    static_cast<unsigned short>(flags >> IORING_CQE_BUFFER_SHIFT);
+                if (mOrphaned || res <= 0) {
+                    mBuffers->recycle(bufId);
+                } else {
+                    mChunks.push_back({res, bufId});
+                }
+            } else if (!mOrphaned) {
+                // 对端关闭、出错或缓冲区耗尽（-ENOBUFS）也排进队列，保持与数据的先后顺序
+                mChunks.push_back({res, 0});
+            }
+            if (reapOrphan()) {
+                return nullptr;
+            }
+            return ready() ? takeWaiter() : nullptr;
+        }
+
+        std::coroutine_handle<> onTimer() {
+            mTimerArmed = mTimerCanceling = false;
+            if (reapOrphan() || !mWaiter) {
+                return nullptr;
+            }
+            // 撤销的 CQE 到达之前可能已经开始了新的等待，醒来时按最新的截止时间判断，没到就续上
+            auto now = std::chrono::steady_clock::now();
+            if (now < mDeadline) {
+                armTimer(mDeadline - now);
+                return nullptr;
+            }
+            mTimedOut = true;
+            return takeWaiter();
+        }
+
+        void orphan() {
+            mOrphaned = true;
+            mWaiter = nullptr;
+            for (; ready(); popFront()) {
+                if (front().res > 0) {
+                    mBuffers->recycle(front().bufId);
+                }
+            }
+            if (mArmed) {
+                UringOp().prep_cancel64(userData(), 0).startDetach();
+            }
+            cancelTimer();
+            reapOrphan();
+        }
+
+        struct Awaiter {
+            State *mState;
+
+            bool await_ready() const noexcept {
+                return mState->ready();
+            }
+
+            void await_suspend(std::coroutine_handle<> coroutine) noexcept {
+                mState->mWaiter = coroutine;
+            }
+
+            void await_resume() const noexcept {}
+        };
+    };
+
+    SocketMultishotRecv::SocketMultishotRecv(SocketHandle &sock)
+        : mSock(sock),
+          mState(new State(sock.fileNo(),
+                           PlatformIOContext::instance->providedBuffers())) {}
+
+    SocketMultishotRecv::~SocketMultishotRecv() {
+        mState->orphan();
+    }
+
+    bool SocketMultishotRecv::supported() {
+        return PlatformIOContext::instance->providedBuffers() != nullptr;
+    }
+
+    bool SocketMultishotRecv::ready() const noexcept {
+        return mState->ready();
+    }
+
+    Task<Expected<>>
+    SocketMultishotRecv::wait(std::chrono::steady_clock::duration timeout,
+                              CancelToken cancel) {
+        State *s = mState;
+        if (s->ready()) {
+            co_return {};
+        }
+        if (!s->mArmed) {
+            s->arm();
+        }
+        s->mTimedOut = s->mCanceled = false;
+        s->mDeadline = std::chrono::steady_clock::now() + timeout;
+        if (!s->mTimerArmed) {
+            s->armTimer(timeout);
+        }
+        CancelCallback _(cancel, [s] {
+            if (auto coroutine = s->takeWaiter()) {
+                s->mCanceled = true;
+                coroutine.resume();
+            }
+        });
+        co_await State::Awaiter{s};
+        // 数据到达或被取消时不再需要定时器，撤销它，免得空闲连接上一直挂着一个 SQE
+        if (!s->mTimedOut) {
+            s->cancelTimer();
+        }
+        if (s->mCanceled) [[unlikely]] {
+            co_return std::errc::operation_canceled;
+        }
+        if (s->mTimedOut) [[unlikely]] {
+            co_return std::errc::stream_timeout;
+        }
+        co_return {};
+    }
+
+    Task<Expected<std::size_t>>
+    SocketMultishotRecv::read(std::span<char> buf,
+                              std::chrono::steady_clock::duration timeout,
+                              CancelToken cancel) {
+        co_await co_await wait(timeout, cancel);
+        State *s = mState;
+        auto &chunk = s->front();
+        if (chunk.res == -ENOBUFS) [[unlikely]] {
+            // 共享缓冲区暂时被其他连接占满，这一次退回到读入调用方的缓冲区
+            s->popFront();
+            co_return co_await socket_read(mSock, buf, timeout, cancel);
+        }
+        if (chunk.res < 0) [[unlikely]] {
+            int res = chunk.res;
+            s->popFront();
+            co_return std::errc(-res);
+        }
+        if (chunk.res == 0) {
+            co_return std::size_t(0); // 对端关闭，留在队列里让之后的 read 也返回 0
+        }
+        auto data = s->mBuffers->buffer(chunk.bufId,
+                                        static_cast<std::size_t>(chunk.res))
+                        .subspan(s->mChunkOffset);
+        std::size_t n = std::min(data.size(), buf.size());
+        std::memcpy(buf.data(), data.data(), n);
+        s->mChunkOffset += n;
+        if (n == data.size()) {
+            s->mBuffers->recycle(chunk.bufId);
+            s->popFront();
+        }
+        co_return n;
+    }
+
+    void SocketMultishotRecv::drain(String &out) {
+        State *s = mState;
+        while (s->ready() && s->front().res > 0) {
+            auto &chunk = s->front();
+            auto data = s->mBuffers->buffer(chunk.bufId,
+                                            static_cast<std::size_t>(chunk.res))
+                            .subspan(s->mChunkOffset);
+            out.append(data.data(), data.size());
+            s->mBuffers->recycle(chunk.bufId);
+            s->popFront();
+        }
+    }
+}
@@ -123,6 +123,11 @@ struct [[nodiscard]] SocketListener : SocketHandle {
     using SocketHandle::SocketHandle;
 };
 
+// 固定文件表里的套接字，热点连接上省去每次操作的 fd 查找和引用计数
+struct [[nodiscard]] DirectSocketHandle : DirectFileHandle {
+    using DirectFileHandle::DirectFileHandle;
+};
+
 SocketAddress get_socket_address(SocketHandle &sock);
 SocketAddress get_socket_peer_address(SocketHandle &sock);
 
@@ -188,4 +193,69 @@ Task<Expected<std::size_t>>
 socket_read(SocketHandle &sock, std::span<char> buf,
             std::chrono::steady_clock::duration timeout, CancelToken cancel);
 Task<Expected<>> socket_shutdown(SocketHandle &sock, int how = SHUT_RDWR);
+
+// 固定文件表版本：表满或内核不支持时 socket_register 返回错误，调用方可以继续使用普通 fd
+Expected<DirectSocketHandle> socket_register(SocketHandle sock);
+Task<Expected<DirectSocketHandle>> listener_accept_direct(SocketListener &listener);
+Task<Expected<std::size_t>> socket_write(DirectSocketHandle &sock,
+                                         std::span<char const> buf);
+Task<Expected<std::size_t>> socket_read(DirectSocketHandle &sock,
+                                        std::span<char> buf);
+Task<Expected<std::size_t>>
+socket_write(DirectSocketHandle &sock, std::span<char const> buf,
+             std::chrono::steady_clock::duration timeout, CancelToken cancel);
+Task<Expected<std::size_t>>
+socket_read(DirectSocketHandle &sock, std::span<char> buf,
+            std::chrono::steady_clock::duration timeout, CancelToken cancel);
+
+/*
+    多发 accept：一次提交持续产出新连接，内核结束多发时自动重新提交
+    以生成器的形式使用：
+        auto gen = listener_accept_multishot(listener);
+        while (auto sock = co_await gen) {
+            co_spawn(serve(std::move(*sock)));
+        }
+    文件描述符或内存耗尽时短暂退避后重新提交，不会结束生成器
+    取走得太慢、积压的连接达到上限时暂停多发，新连接留在内核的监听队列里，积压取完后再继续
+    生成器只在被取消或遇到不可恢复的错误时结束，原因通过 result() 获得
+    内核不支持多发 accept（5.19 之前）时退回到逐个 listener_accept
+*/
+Task<GeneratorResult<SocketHandle, Expected<>>>
+listener_accept_multishot(SocketListener &listener);
+
+/*
+    基于多发接收和内核挑选缓冲区的套接字读取
+    只提交一次接收，之后每段到达的数据都落在 PlatformIOContext 共享的缓冲区里排队，由 read 拷贝取走
+    连接空闲时不占用任何读缓冲；内核结束多发或缓冲区耗尽后，下一次 read 会自动重新提交
+    只能在创建它的 IOContext 线程上使用，销毁时未完成的接收会被异步取消
+*/
+struct SocketMultishotRecv {
+    explicit SocketMultishotRecv(SocketHandle &sock);
+    SocketMultishotRecv(SocketMultishotRecv &&) = delete;
+    ~SocketMultishotRecv();
+
+    // 当前线程的 IOContext 是否支持内核挑选缓冲区（5.19 及以上）
+    static bool supported();
+
+    // 是否已有数据（或对端关闭、出错）到达，可以不等待地 read
+    bool ready() const noexcept;
+
+    // 等待数据到达但不取走，超时返回 stream_timeout
+    Task<Expected<>> wait(std::chrono::steady_clock::duration timeout,
+                          CancelToken cancel = {});
+
+    // 把已到达的数据拷贝进 buf，没有数据时先等待；返回 0 表示对端已关闭
+    Task<Expected<std::size_t>> read(std::span<char> buf,
+                                     std::chrono::steady_clock::duration timeout,
+                                     CancelToken cancel = {});
+
+    // 不等待地取走所有已到达的数据追加到 out，对端关闭和错误不会被取走
+    void drain(String &out);
+
+private:
+    struct State;
+
+    SocketHandle &mSock;
+    State *mState;
+};
 } // namespace co_async
@@ -0,0 +1,85 @@
+#include <std.hpp>
+#include <awaiter/task.hpp>
+#include <generic/generic_io.hpp>
+#include <generic/io_context.hpp>
+#include <platform/platform_io.hpp>
+#include <platform/socket.hpp>
+#include "test_utils.hpp"
+
+/*
+    多发 accept 与逐个 accept 的接受速率对比：
+    客户端线程用阻塞的 connect 在回环地址上连续建立连接后立即关闭，
+    服务端协程分别用 listener_accept_multishot 和 listener_accept 接受同样数量的连接
+    用法：accept_bench [连接数]
+*/
+
+using namespace zh_async;
+
+static void connectLoop(int port, std::size_t numConns) {
+    struct sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<std::uint16_t>(port));
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    for (std::size_t i = 0; i < numConns; ++i) {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        ZH_ASYNC_CHECK(fd >= 0);
+        ZH_ASYNC_CHECK(connect(fd, reinterpret_cast<struct sockaddr *>(&addr),
+                               sizeof(addr)) == 0);
+        close(fd);
+    }
+}
+
+static Task<> acceptMultishot(SocketListener &listener, std::size_t numConns) {
+    auto gen = listener_accept_multishot(listener);
+    for (std::size_t i = 0; i < numConns; ++i) {
+        auto sock = co_await gen;
+        ZH_ASYNC_CHECK(sock.has_value());
+    }
+}
+
+static Task<> acceptOneshot(SocketListener &listener, std::size_t numConns) {
+    for (std::size_t i = 0; i < numConns; ++i) {
+        auto sock = co_await listener_accept(listener);
+        ZH_ASYNC_CHECK(sock.has_value());
+    }
+}
+
+static Task<Expected<>> bindLoopback(std::optional<SocketListener> &listener) {
+    auto addr = co_await AddressResolver()
+                    .host("127.0.0.1")
+                    .port(0)
+                    .socktype(SOCK_STREAM)
+                    .resolve_one();
+    listener.emplace(co_await co_await listener_bind(addr));
+    co_return {};
+}
+
+template <class F>
+static void measure(std::string_view name, IOContext &ctx, int port,
+                    std::size_t numConns, F acceptAll) {
+    double ns = test::time_ns([&] {
+        std::jthread client(connectLoop, port, numConns);
+        co_spawn(acceptAll(numConns));
+        ctx.run();
+    });
+    test::report(name, numConns, ns);
+}
+
+int main(int argc, char **argv) {
+    std::size_t numConns = test::arg_or(argc, argv, 1, 20000);
+
+    IOContext ctx;
+    std::optional<SocketListener> listener;
+    co_spawn(co_catch(bindLoopback(listener)));
+    ctx.run();
+    ZH_ASYNC_CHECK(listener.has_value());
+    int port = get_socket_address(*listener).port();
+
+    measure("multishot accept", ctx, port, numConns, [&](std::size_t n) {
+        return acceptMultishot(*listener, n);
+    });
+    measure("one-shot accept", ctx, port, numConns, [&](std::size_t n) {
+        return acceptOneshot(*listener, n);
+    });
+    return 0;
+}
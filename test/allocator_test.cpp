@@ -0,0 +1,149 @@
+#include <std.hpp>
+#include <awaiter/task.hpp>
+#include <generic/allocator.hpp>
+#include <generic/generic_io.hpp>
+#include <generic/io_context.hpp>
+#include <platform/platform_io.hpp>
+#include "test_utils.hpp"
+
+/*
+    任务树绑定分配器的测试（需要开启 ZH_ASYNC_ALLOC），全部在单个 IOContext 上运行：
+    1. co_with_allocator 的任务树里创建的协程帧和 String 都从绑定的资源分配，在树外释放时还给同一个资源
+    2. 任务树在 I/O 上挂起、由事件循环恢复后仍然使用绑定的资源，挂起期间事件循环里的其他协程不受影响
+    3. co_arena 的任务树从 arena 分配，挂起前后都是；在里面 co_spawn 抛出 std::logic_error，
+       用 ReplaceAllocator 换回帧池之后可以 co_spawn，树挂起期间其他协程也可以
+*/
+
+using namespace zh_async;
+
+struct CountingResource : std::pmr::memory_resource {
+    std::size_t mAllocs = 0;
+    std::size_t mDeallocs = 0;
+
+    void *do_allocate(size_t size, size_t align) override {
+        ++mAllocs;
+        return std::pmr::new_delete_resource()->allocate(size, align);
+    }
+
+    void do_deallocate(void *p, size_t size, size_t align) override {
+        ++mDeallocs;
+        std::pmr::new_delete_resource()->deallocate(p, size, align);
+    }
+
+    bool do_is_equal(
+        std::pmr::memory_resource const &other) const noexcept override {
+        return this == &other;
+    }
+};
+
+static Task<> leaf(std::pmr::memory_resource *expected) {
+    ZH_ASYNC_CHECK(currentAllocator == expected);
+    co_return;
+}
+
+static Task<> treeAcrossSuspension(std::pmr::memory_resource *expected,
+                                   CountingResource &counting, String &out) {
+    ZH_ASYNC_CHECK(currentAllocator == expected);
+    co_await leaf(expected);
+    std::size_t before = counting.mAllocs;
+    (void)co_await UringOp().prep_nop();
+    // 由事件循环恢复，分配器仍是绑定的那个
+    ZH_ASYNC_CHECK(currentAllocator == expected);
+    co_await leaf(expected);
+    ZH_ASYNC_CHECK(counting.mAllocs > before);
+    out = String(200, 'x');
+}
+
+static Task<> bystander(std::pmr::memory_resource *outer, bool &ran) {
+    // 和任务树同时挂起、由事件循环恢复，看到的应该是树外的分配器
+    (void)co_await UringOp().prep_nop();
+    ZH_ASYNC_CHECK(currentAllocator == outer);
+    ran = true;
+}
+
+static Task<> testWithAllocator() {
+    CountingResource counting;
+    std::pmr::memory_resource *outer = currentAllocator;
+    bool ran = false;
+    {
+        String s;
+        auto tree = co_with_allocator(
+            &counting, treeAcrossSuspension(&counting, counting, s));
+        ZH_ASYNC_CHECK(counting.mAllocs == 0);
+        co_spawn(bystander(outer, ran));
+        co_await std::move(tree);
+        ZH_ASYNC_CHECK(currentAllocator == outer);
+        ZH_ASYNC_CHECK(s.size() == 200);
+    }
+    while (!ran) {
+        (void)co_await UringOp().prep_nop();
+    }
+    ZH_ASYNC_CHECK(counting.mAllocs > 0);
+    // 树里分配的协程帧和 String 都在树外释放，释放时还给了 counting 而不是当前的分配器
+    ZH_ASYNC_CHECK(counting.mDeallocs == counting.mAllocs);
+}
+
+static Task<> trySpawn(bool &ran) {
+    ran = true;
+    co_return;
+}
+
+static Task<> arenaHandler(int &step) {
+    auto arena = dynamic_cast<ArenaResource *>(currentAllocator);
+    ZH_ASYNC_CHECK(arena);
+    bool ran = false;
+    bool thrown = false;
+    try {
+        co_spawn(trySpawn(ran));
+    } catch (std::logic_error const &) {
+        thrown = true;
+    }
+    ZH_ASYNC_CHECK(thrown && !ran);
+    step = 1;
+    (void)co_await UringOp().prep_nop();
+    ZH_ASYNC_CHECK(currentAllocator == arena);
+    co_await leaf(arena);
+    thrown = false;
+    try {
+        co_spawn(trySpawn(ran));
+    } catch (std::logic_error const &) {
+        thrown = true;
+    }
+    ZH_ASYNC_CHECK(thrown && !ran);
+    {
+        ReplaceAllocator detach(frame_pool_resource());
+        co_spawn(trySpawn(ran));
+    }
+    ZH_ASYNC_CHECK(ran);
+    ZH_ASYNC_CHECK(currentAllocator == arena);
+    step = 2;
+}
+
+static Task<> testArena() {
+    std::pmr::memory_resource *outer = currentAllocator;
+    int step = 0;
+    co_spawn(co_arena(arenaHandler, std::ref(step)));
+    // arena 的任务树挂起在 nop 上，这里已经回到了树外
+    ZH_ASYNC_CHECK(step == 1);
+    ZH_ASYNC_CHECK(currentAllocator == outer);
+    bool ran = false;
+    co_spawn(trySpawn(ran));
+    ZH_ASYNC_CHECK(ran);
+    while (step != 2) {
+        (void)co_await UringOp().prep_nop();
+    }
+    ZH_ASYNC_CHECK(currentAllocator == outer);
+}
+
+static void runTest(Task<> (*test)()) {
+    IOContext ctx;
+    co_spawn(test());
+    ctx.run();
+}
+
+int main() {
+    runTest(testWithAllocator);
+    runTest(testArena);
+    std::cout << "allocator_test: ok\n";
+    return 0;
+}
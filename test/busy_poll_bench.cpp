@@ -0,0 +1,63 @@
+#include <std.hpp>
+#include <awaiter/task.hpp>
+#include <generic/generic_io.hpp>
+#include <generic/io_context.hpp>
+#include <generic/io_context_mt.hpp>
+#include <platform/platform_io.hpp>
+#include "test_utils.hpp"
+
+/*
+    忙轮询对跨线程唤醒延迟的影响：
+    主线程每隔一小段时间向单个 worker 投递一个协程，协程记录从投递到开始执行的时间
+    分别在关闭和开启 IOContextOptions::busyPoll 时测量，打印两组延迟的百分位分布
+    用法：busy_poll_bench [投递次数] [投递间隔（微秒）] [自旋上限（微秒）]
+*/
+
+using namespace zh_async;
+
+static test::LatencyHistogram gHistogram;
+static std::atomic<bool> gDone{false};
+
+static Task<> ping(std::chrono::steady_clock::time_point postedAt) {
+    gHistogram.add(std::chrono::steady_clock::now() - postedAt);
+    gDone.store(true, std::memory_order_release);
+    gDone.notify_one();
+    co_return;
+}
+
+static void measure(std::string_view name, std::size_t numPings,
+                    std::chrono::microseconds gap,
+                    std::chrono::steady_clock::duration busyPoll) {
+    gHistogram.samples.clear();
+    gHistogram.samples.reserve(numPings);
+    IOContextMT mt;
+    IOContextMT::start(IOContextMTOptions{
+        .numWorkers = 1,
+        .workerOptions = IOContextOptions{.busyPoll = busyPoll},
+    });
+    for (std::size_t i = 0; i < numPings; ++i) {
+        // 用自旋而不是 sleep 控制间隔，避免主线程自己的唤醒延迟混进间隔里
+        auto next = std::chrono::steady_clock::now() + gap;
+        while (std::chrono::steady_clock::now() < next) {
+        }
+        gDone.store(false, std::memory_order_relaxed);
+        co_spawn(IOContextMT::nth_worker(0),
+                 ping(std::chrono::steady_clock::now()));
+        gDone.wait(false, std::memory_order_acquire);
+    }
+    IOContextMT::stop();
+    IOContextMT::join();
+    ZH_ASYNC_CHECK(gHistogram.samples.size() == numPings);
+    gHistogram.print(name);
+}
+
+int main(int argc, char **argv) {
+    std::size_t numPings = test::arg_or(argc, argv, 1, 20000);
+    std::chrono::microseconds gap(test::arg_or(argc, argv, 2, 20));
+    std::chrono::microseconds spin(test::arg_or(argc, argv, 3, 100));
+
+    measure("busy poll off", numPings, gap,
+            std::chrono::steady_clock::duration::zero());
+    measure("busy poll on", numPings, gap, spin);
+    return 0;
+}
@@ -0,0 +1,86 @@
+#include <std.hpp>
+#include <awaiter/task.hpp>
+#include <generic/generic_io.hpp>
+#include <generic/io_context.hpp>
+#include <generic/io_context_mt.hpp>
+#include <generic/queue.hpp>
+#include <platform/platform_io.hpp>
+#include "test_utils.hpp"
+
+/*
+    异步 ConcurrentQueue 在不同生产者 / 消费者线程数下的吞吐：
+    每个生产者和消费者协程独占一个 worker，生产者共 co_await push N 个元素，消费者共 co_await pop N 个
+    队列容量较小时两端会频繁在满 / 空时挂起，测到的是包含跨线程唤醒在内的交接开销
+    用法：concurrent_queue_bench [元素数] [队列容量]
+*/
+
+using namespace zh_async;
+
+static std::atomic<std::size_t> gRemaining{0};
+
+static void finish() {
+    if (gRemaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        gRemaining.notify_all();
+    }
+}
+
+static Task<> producer(ConcurrentQueue<std::size_t> &queue, std::size_t count) {
+    for (std::size_t i = 0; i < count; ++i) {
+        auto res = co_await queue.push(i);
+        ZH_ASYNC_CHECK(!res.has_error());
+    }
+    finish();
+}
+
+static Task<> consumer(ConcurrentQueue<std::size_t> &queue, std::size_t count) {
+    for (std::size_t i = 0; i < count; ++i) {
+        auto res = co_await queue.pop();
+        ZH_ASYNC_CHECK(!res.has_error());
+    }
+    finish();
+}
+
+// 把 total 尽量平均地分给 parts 份，第 i 份的个数
+static std::size_t share(std::size_t total, std::size_t parts, std::size_t i) {
+    return total / parts + (i < total % parts ? 1 : 0);
+}
+
+static void measure(std::size_t numProducers, std::size_t numConsumers,
+                    std::size_t numItems, std::size_t capacity) {
+    ConcurrentQueue<std::size_t> queue(capacity);
+    IOContextMT mt;
+    IOContextMT::start(IOContextMTOptions{.numWorkers = numProducers + numConsumers});
+    gRemaining.store(numProducers + numConsumers);
+    double ns = test::time_ns([&] {
+        for (std::size_t i = 0; i < numConsumers; ++i) {
+            co_spawn(IOContextMT::nth_worker(numProducers + i),
+                     consumer(queue, share(numItems, numConsumers, i)));
+        }
+        for (std::size_t i = 0; i < numProducers; ++i) {
+            co_spawn(IOContextMT::nth_worker(i),
+                     producer(queue, share(numItems, numProducers, i)));
+        }
+        while (std::size_t n = gRemaining.load(std::memory_order_acquire)) {
+            gRemaining.wait(n);
+        }
+    });
+    IOContextMT::stop();
+    IOContextMT::join();
+    ZH_ASYNC_CHECK(!queue.try_pop());
+    std::string name = std::to_string(numProducers) + " producers, " +
+                       std::to_string(numConsumers) + " consumers";
+    test::report(name, numItems, ns);
+}
+
+int main(int argc, char **argv) {
+    std::size_t numItems = test::arg_or(argc, argv, 1, 1000000);
+    std::size_t capacity = test::arg_or(argc, argv, 2, 1024);
+
+    std::pair<std::size_t, std::size_t> const configs[] = {
+        {1, 1}, {1, 4}, {4, 1}, {2, 2}, {4, 4},
+    };
+    for (auto [numProducers, numConsumers]: configs) {
+        measure(numProducers, numConsumers, numItems, capacity);
+    }
+    return 0;
+}
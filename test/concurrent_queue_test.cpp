@@ -0,0 +1,159 @@
+#include <std.hpp>
+#include <utils/concurrent_queue.hpp>
+#include "test_utils.hpp"
+
+/*
+    无锁 MPMC 环形队列的多线程压力测试：
+    容量很小，生产者和消费者的位置反复回绕，大部分 push / pop 都会撞上满或空
+    每个值编码了生产者编号和序号，检查：
+        每个值恰好被取出一次，没有丢失也没有重复
+        同一个消费者看到的同一个生产者的值按序号递增（队列按位置线性化）
+    一半的线程改用 push_bulk / pop_bulk，覆盖批量操作与单个操作交错的情况
+    用法：concurrent_queue_test [每个生产者的元素数] [生产者数] [消费者数] [容量]
+*/
+
+using namespace zh_async;
+
+static constexpr int kSeqBits = 40;
+
+static std::uint64_t encode(std::size_t producer, std::size_t seq) {
+    return (static_cast<std::uint64_t>(producer) << kSeqBits) | seq;
+}
+
+struct ConsumerLog {
+    std::vector<std::uint64_t> values;
+};
+
+static void produce(ConcurrentRingQueue<std::uint64_t> &queue, std::size_t id,
+                    std::size_t count, bool bulk) {
+    std::size_t seq = 0;
+    std::vector<std::uint64_t> batch;
+    while (seq < count) {
+        if (bulk) {
+            batch.clear();
+            for (std::size_t i = 0; i < 7 && seq + i < count; ++i) {
+                batch.push_back(encode(id, seq + i));
+            }
+            std::size_t n = queue.push_bulk(std::span(batch));
+            seq += n;
+            if (!n) {
+                std::this_thread::yield();
+            }
+        } else if (queue.push(encode(id, seq))) {
+            ++seq;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+static void consume(ConcurrentRingQueue<std::uint64_t> &queue,
+                    std::atomic<std::size_t> &remaining, ConsumerLog &log,
+                    bool bulk) {
+    std::uint64_t batch[5];
+    while (remaining.load(std::memory_order_relaxed) != 0) {
+        std::size_t n = 0;
+        if (bulk) {
+            n = queue.pop_bulk(batch, std::size(batch));
+            log.values.insert(log.values.end(), batch, batch + n);
+        } else if (auto value = queue.pop()) {
+            log.values.push_back(*value);
+            n = 1;
+        }
+        if (n) {
+            remaining.fetch_sub(n, std::memory_order_relaxed);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+static void stress(std::size_t perProducer, std::size_t numProducers,
+                   std::size_t numConsumers, std::size_t capacity) {
+    ConcurrentRingQueue<std::uint64_t> queue(capacity);
+    std::atomic<std::size_t> remaining{perProducer * numProducers};
+    std::vector<ConsumerLog> logs(numConsumers);
+    {
+        std::vector<std::jthread> threads;
+        for (std::size_t i = 0; i < numConsumers; ++i) {
+            threads.emplace_back(consume, std::ref(queue), std::ref(remaining),
+                                 std::ref(logs[i]), i % 2 == 1);
+        }
+        for (std::size_t i = 0; i < numProducers; ++i) {
+            threads.emplace_back(produce, std::ref(queue), i, perProducer,
+                                 i % 2 == 1);
+        }
+    }
+    ZH_ASYNC_CHECK(queue.empty());
+    ZH_ASYNC_CHECK(!queue.pop());
+
+    std::vector<std::vector<bool>> seen(numProducers,
+                                        std::vector<bool>(perProducer));
+    std::size_t total = 0;
+    for (auto &log: logs) {
+        std::vector<std::size_t> next(numProducers, 0);
+        for (std::uint64_t value: log.values) {
+            auto producer = static_cast<std::size_t>(value >> kSeqBits);
+            auto seq = static_cast<std::size_t>(
+                value & ((std::uint64_t(1) << kSeqBits) - 1));
+            ZH_ASYNC_CHECK(producer < numProducers && seq < perProducer);
+            ZH_ASYNC_CHECK(!seen[producer][seq]);
+            ZH_ASYNC_CHECK(seq >= next[producer]);
+            seen[producer][seq] = true;
+            next[producer] = seq + 1;
+            ++total;
+        }
+    }
+    ZH_ASYNC_CHECK(total == perProducer * numProducers);
+}
+
+// 单线程下满、空和回绕的边界
+static void testBoundaries() {
+    ConcurrentRingQueue<std::uint64_t> queue(5);
+    ZH_ASYNC_CHECK(queue.max_size() == 8);
+    for (std::uint64_t round = 0; round < 3; ++round) {
+        for (std::uint64_t i = 0; i < 8; ++i) {
+            ZH_ASYNC_CHECK(queue.push(round * 8 + i));
+        }
+        ZH_ASYNC_CHECK(!queue.push(99));
+        ZH_ASYNC_CHECK(queue.size() == 8);
+        for (std::uint64_t i = 0; i < 8; ++i) {
+            ZH_ASYNC_CHECK(queue.pop() == round * 8 + i);
+        }
+        ZH_ASYNC_CHECK(!queue.pop());
+    }
+    // 起点不在 0 时批量操作跨过缓冲区末尾
+    ZH_ASYNC_CHECK(queue.push(1) && queue.push(2) && queue.push(3));
+    ZH_ASYNC_CHECK(queue.pop() == 1 && queue.pop() == 2);
+    std::uint64_t values[10] = {10, 11, 12, 13, 14, 15, 16, 17, 18, 19};
+    ZH_ASYNC_CHECK(queue.push_bulk(std::span(values)) == 7);
+    std::uint64_t out[10];
+    ZH_ASYNC_CHECK(queue.pop_bulk(out, 10) == 8);
+    ZH_ASYNC_CHECK(out[0] == 3 && out[1] == 10 && out[7] == 16);
+    ZH_ASYNC_CHECK(queue.pop_bulk(out, 10) == 0);
+}
+
+// 只能移动的元素类型：检查槽位里的值被完整移出，没有残留或泄漏
+static void testMoveOnly() {
+    ConcurrentRingQueue<std::unique_ptr<int>> queue(4);
+    for (int i = 0; i < 100; ++i) {
+        ZH_ASYNC_CHECK(queue.push(std::make_unique<int>(i)));
+        auto value = queue.pop();
+        ZH_ASYNC_CHECK(value && *value && **value == i);
+    }
+}
+
+int main(int argc, char **argv) {
+    std::size_t perProducer = test::arg_or(argc, argv, 1, 200000);
+    std::size_t numProducers = test::arg_or(argc, argv, 2, 4);
+    std::size_t numConsumers = test::arg_or(argc, argv, 3, 4);
+    std::size_t capacity = test::arg_or(argc, argv, 4, 16);
+
+    testBoundaries();
+    testMoveOnly();
+    stress(perProducer, numProducers, numConsumers, capacity);
+    stress(perProducer, 1, numConsumers, capacity);
+    stress(perProducer, numProducers, 1, capacity);
+    std::cout << "concurrent_queue_test: ok\n";
+    return 0;
+}
@@ -0,0 +1,122 @@
+#include <std.hpp>
+#include <awaiter/task.hpp>
+#include <generic/condition_variable.hpp>
+#include <generic/generic_io.hpp>
+#include <generic/io_context.hpp>
+#include <generic/io_context_mt.hpp>
+#include <platform/platform_io.hpp>
+#include "test_utils.hpp"
+
+/*
+    用户态条件变量的跨线程测试，丢失唤醒会表现为测试卡住：
+    1. 两个 worker 上的协程经同一个条件变量一问一答 N 次，各自用 wait(pred) 等对方推进计数，
+       条件在对方 notify 之前或之后被满足都不能漏掉
+    2. 若干 worker 上的协程用 wait(pred) 等同一个标志，由不属于任何 IOContext 的线程设置标志后 notify_all，
+       每轮都要全部醒来
+    用法：condition_variable_test [往返次数] [广播轮数] [worker 数]
+*/
+
+using namespace zh_async;
+
+static std::atomic<std::size_t> gRemaining{0};
+
+static void finish() {
+    if (gRemaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        gRemaining.notify_all();
+    }
+}
+
+static void waitAll() {
+    while (std::size_t n = gRemaining.load(std::memory_order_acquire)) {
+        gRemaining.wait(n);
+    }
+}
+
+struct PingPong {
+    ConditionVariable mCv;
+    std::atomic<std::size_t> mPing{0};
+    std::atomic<std::size_t> mPong{0};
+};
+
+static Task<> pinger(PingPong &state, std::size_t rounds) {
+    for (std::size_t i = 1; i <= rounds; ++i) {
+        state.mPing.store(i, std::memory_order_release);
+        state.mCv.notify_all();
+        auto res = co_await state.mCv.wait(
+            [&] { return state.mPong.load(std::memory_order_acquire) >= i; });
+        ZH_ASYNC_CHECK(!res.has_error());
+    }
+    finish();
+}
+
+static Task<> ponger(PingPong &state, std::size_t rounds) {
+    for (std::size_t i = 1; i <= rounds; ++i) {
+        auto res = co_await state.mCv.wait(
+            [&] { return state.mPing.load(std::memory_order_acquire) >= i; });
+        ZH_ASYNC_CHECK(!res.has_error());
+        ZH_ASYNC_CHECK(state.mPing.load(std::memory_order_acquire) == i);
+        state.mPong.store(i, std::memory_order_release);
+        state.mCv.notify_all();
+    }
+    finish();
+}
+
+static void testPingPong(std::size_t rounds) {
+    PingPong state;
+    gRemaining.store(2);
+    co_spawn(IOContextMT::nth_worker(1), ponger(state, rounds));
+    co_spawn(IOContextMT::nth_worker(0), pinger(state, rounds));
+    waitAll();
+    ZH_ASYNC_CHECK(state.mPong.load() == rounds);
+}
+
+struct Broadcast {
+    ConditionVariable mCv;
+    std::atomic<std::size_t> mRound{0};
+    std::atomic<std::size_t> mWoken{0};
+};
+
+static Task<> listener(Broadcast &state, std::size_t rounds) {
+    for (std::size_t i = 1; i <= rounds; ++i) {
+        auto res = co_await state.mCv.wait(
+            [&] { return state.mRound.load(std::memory_order_acquire) >= i; });
+        ZH_ASYNC_CHECK(!res.has_error());
+        state.mWoken.fetch_add(1, std::memory_order_acq_rel);
+        state.mWoken.notify_one();
+    }
+    finish();
+}
+
+static void testBroadcast(std::size_t rounds, std::size_t numWorkers) {
+    Broadcast state;
+    gRemaining.store(numWorkers);
+    for (std::size_t i = 0; i < numWorkers; ++i) {
+        co_spawn(IOContextMT::nth_worker(i), listener(state, rounds));
+    }
+    // 主线程没有 IOContext，notify_all 只能经收件箱和门铃把等待者投递回各自的 worker
+    for (std::size_t i = 1; i <= rounds; ++i) {
+        state.mRound.store(i, std::memory_order_release);
+        state.mCv.notify_all();
+        std::size_t target = i * numWorkers;
+        for (std::size_t n; (n = state.mWoken.load(std::memory_order_acquire)) < target;) {
+            state.mWoken.wait(n);
+        }
+    }
+    waitAll();
+    ZH_ASYNC_CHECK(state.mWoken.load() == rounds * numWorkers);
+}
+
+int main(int argc, char **argv) {
+    std::size_t rounds = test::arg_or(argc, argv, 1, 100000);
+    std::size_t broadcasts = test::arg_or(argc, argv, 2, 10000);
+    std::size_t numWorkers = std::max<std::size_t>(test::arg_or(argc, argv, 3, 4), 2);
+
+    IOContextMT mt;
+    IOContextMT::start(IOContextMTOptions{.numWorkers = numWorkers});
+    testPingPong(rounds);
+    testBroadcast(broadcasts, numWorkers);
+    IOContextMT::stop();
+    IOContextMT::join();
+    std::cout << "condition_variable_test: ok\n";
+    return 0;
+}
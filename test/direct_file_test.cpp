@@ -0,0 +1,155 @@
+#include <std.hpp>
+#include <awaiter/task.hpp>
+#include <generic/generic_io.hpp>
+#include <generic/io_context.hpp>
+#include <platform/fs.hpp>
+#include <platform/platform_io.hpp>
+#include <platform/socket.hpp>
+#include "test_utils.hpp"
+
+/*
+    固定文件表（direct descriptor）测试，固定文件表只有 kSlots 个槽位：
+    1. 首次分配时按 fixedFiles 注册表；归还的槽位被下一次分配复用；表满后分配和注册返回 -ENFILE，
+       fs_open_direct / listener_accept_direct 返回 ENFILE；表里有零散归还的槽位时 addFiles 报错，全部归还后从头分配
+    2. fs_open_direct 打开的文件经固定文件版本的 fs_write / fs_read 往返一次，fs_register 注册的文件能读到同样的内容
+    3. listener_accept_direct 接受的连接和 socket_register 注册的连接之间经固定文件版本的 socket_write / socket_read 往返一次
+    内核不支持稀疏注册（5.19 之前）时跳过
+*/
+
+using namespace zh_async;
+
+static constexpr std::size_t kSlots = 4;
+
+static Task<> testSlots(bool &supported) {
+    auto &io = *PlatformIOContext::instance;
+    int a = io.allocFileSlot();
+    if (a == -EOPNOTSUPP) {
+        co_return;
+    }
+    supported = true;
+    int b = io.allocFileSlot();
+    ZH_ASYNC_CHECK(a >= 0 && b >= 0 && a != b);
+    io.releaseFileSlot(a);
+    ZH_ASYNC_CHECK(io.allocFileSlot() == a);
+
+    int fds[2];
+    ZH_ASYNC_CHECK(pipe(fds) == 0);
+    int c = io.registerFile(fds[0]);
+    int d = io.allocFileSlot();
+    ZH_ASYNC_CHECK(c >= 0 && d >= 0);
+    ZH_ASYNC_CHECK(io.allocFileSlot() == -ENFILE);
+    ZH_ASYNC_CHECK(io.registerFile(fds[1]) == -ENFILE);
+    auto file = co_await fs_open_direct(make_path("/dev/null"), OpenMode::Read);
+    ZH_ASYNC_CHECK(file.has_error() &&
+                   file.error() == std::errc::too_many_files_open_in_system);
+    // 分配槽位在 accept 之前就失败了，用不到监听套接字
+    SocketListener listener;
+    auto sock = co_await listener_accept_direct(listener);
+    ZH_ASYNC_CHECK(sock.has_error() &&
+                   sock.error() == std::errc::too_many_files_open_in_system);
+
+    // 有槽位在用时归还一个，表里出现空洞
+    io.releaseFileSlot(c);
+    bool thrown = false;
+    try {
+        (void)io.addFiles(std::span<int const>(fds, 1));
+    } catch (std::logic_error const &) {
+        thrown = true;
+    }
+    ZH_ASYNC_CHECK(thrown);
+    ZH_ASYNC_CHECK(io.registerFile(fds[1]) == c);
+
+    for (int slot: {a, b, c, d}) {
+        io.releaseFileSlot(slot);
+    }
+    ZH_ASYNC_CHECK(io.addFiles(std::span<int const>(fds, 2)) == 0);
+    ZH_ASYNC_CHECK(io.allocFileSlot() == 2);
+    for (int slot: {0, 1, 2}) {
+        io.releaseFileSlot(slot);
+    }
+    close(fds[0]);
+    close(fds[1]);
+}
+
+static Task<Expected<>> testFileRoundTrip() {
+    auto path = std::filesystem::temp_directory_path() /
+                ("zh_async_direct_file_test." + std::to_string(getpid()));
+    std::string_view message = "hello from the fixed file table";
+    {
+        auto file = co_await co_await fs_open_direct(path, OpenMode::ReadWrite);
+        ZH_ASYNC_CHECK(file.fileIndex() >= 0);
+        auto n = co_await co_await fs_write(file, message, 0);
+        ZH_ASYNC_CHECK(n == message.size());
+        char buf[64]{};
+        n = co_await co_await fs_read(file, std::span<char>(buf), 0);
+        ZH_ASYNC_CHECK(std::string_view(buf, n) == message);
+    }
+    {
+        auto file =
+            co_await fs_register(co_await co_await fs_open(path, OpenMode::Read));
+        char buf[64]{};
+        auto n = co_await co_await fs_read(file, std::span<char>(buf), 0);
+        ZH_ASYNC_CHECK(std::string_view(buf, n) == message);
+    }
+    co_await co_await fs_unlink(path);
+    co_return {};
+}
+
+static Task<Expected<>> echoServer(SocketListener &listener) {
+    auto sock = co_await co_await listener_accept_direct(listener);
+    char buf[64];
+    auto n = co_await co_await socket_read(sock, std::span<char>(buf));
+    co_await co_await socket_write(sock, std::span<char const>(buf, n));
+    co_return {};
+}
+
+static Task<Expected<>> testSocketRoundTrip() {
+    auto addr = co_await AddressResolver()
+                    .host("127.0.0.1")
+                    .port(0)
+                    .socktype(SOCK_STREAM)
+                    .resolve_one();
+    auto listener = co_await co_await listener_bind(addr);
+    co_spawn(co_catch(echoServer(listener)));
+    auto sock = co_await socket_register(
+        co_await co_await socket_connect(get_socket_address(listener)));
+    std::string_view message = "ping";
+    auto n = co_await co_await socket_write(sock, message);
+    ZH_ASYNC_CHECK(n == message.size());
+    char buf[64];
+    std::size_t got = 0;
+    while (got < message.size()) {
+        n = co_await co_await socket_read(
+            sock, std::span<char>(buf + got, sizeof(buf) - got));
+        ZH_ASYNC_CHECK(n != 0);
+        got += n;
+    }
+    ZH_ASYNC_CHECK(std::string_view(buf, got) == message);
+    co_return {};
+}
+
+template <class F>
+static void runTest(F test) {
+    IOContext ctx(IOContextOptions{.ringSetup = {.fixedFiles = kSlots}});
+    co_spawn(test());
+    ctx.run();
+}
+
+static Task<> checked(Task<Expected<>> task) {
+    auto res = co_await std::move(task);
+    ZH_ASYNC_CHECK(!res.has_error());
+}
+
+int main() {
+    bool supported = false;
+    runTest([&] { return testSlots(supported); });
+    if (!supported) {
+        std::cout << "direct_file_test: sparse file tables not supported, "
+                     "skipped\n";
+        return 0;
+    }
+    runTest([] { return checked(testFileRoundTrip()); });
+    runTest([] { return checked(testSocketRoundTrip()); });
+    std::cout << "direct_file_test: ok\n";
+    return 0;
+}
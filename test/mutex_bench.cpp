@@ -0,0 +1,71 @@
+#include <std.hpp>
+#include <awaiter/task.hpp>
+#include <generic/generic_io.hpp>
+#include <generic/io_context.hpp>
+#include <generic/io_context_mt.hpp>
+#include <generic/mutex.hpp>
+#include <platform/platform_io.hpp>
+#include "test_utils.hpp"
+
+/*
+    异步互斥锁在不同竞争程度下的吞吐：
+    1、4、64 个协程轮流分布到各个 worker 上，每个协程反复 lock / 累加共享计数 / unlock
+    1 个协程时只走无竞争的 CAS 快速路径，协程数超过 worker 数后等待者排队并由 unlock 直接交接
+    每种协程数分别测量不自旋和先自旋若干次再排队两种配置
+    用法：mutex_bench [每个协程的加锁次数] [worker 数] [自旋次数]
+*/
+
+using namespace zh_async;
+
+static std::atomic<std::size_t> gRemaining{0};
+static std::size_t gCounter = 0; // 只在持锁时修改
+
+static Task<> contender(BasicMutex &mutex, std::size_t ops) {
+    for (std::size_t i = 0; i < ops; ++i) {
+        auto res = co_await mutex.lock();
+        ZH_ASYNC_CHECK(!res.has_error());
+        ++gCounter;
+        mutex.unlock();
+    }
+    if (gRemaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        gRemaining.notify_all();
+    }
+}
+
+static void measure(std::size_t numCoroutines, std::size_t ops,
+                    std::uint32_t spinCount) {
+    BasicMutex mutex(spinCount);
+    gCounter = 0;
+    gRemaining.store(numCoroutines);
+    double ns = test::time_ns([&] {
+        for (std::size_t i = 0; i < numCoroutines; ++i) {
+            co_spawn(IOContextMT::nth_worker(i % IOContextMT::num_workers()),
+                     contender(mutex, ops));
+        }
+        while (std::size_t n = gRemaining.load(std::memory_order_acquire)) {
+            gRemaining.wait(n);
+        }
+    });
+    // 最后一个 unlock 发生在 gRemaining 归零之前，这里读到的是完整的计数
+    ZH_ASYNC_CHECK(gCounter == numCoroutines * ops);
+    std::string name = std::to_string(numCoroutines) + " coroutines, spin " +
+                       std::to_string(spinCount);
+    test::report(name, numCoroutines * ops, ns);
+}
+
+int main(int argc, char **argv) {
+    std::size_t ops = test::arg_or(argc, argv, 1, 100000);
+    std::size_t numWorkers = test::arg_or(
+        argc, argv, 2, std::max<std::size_t>(std::thread::hardware_concurrency(), 2));
+    auto spin = static_cast<std::uint32_t>(test::arg_or(argc, argv, 3, 100));
+
+    IOContextMT mt;
+    IOContextMT::start(IOContextMTOptions{.numWorkers = numWorkers});
+    for (std::size_t numCoroutines: {1, 4, 64}) {
+        measure(numCoroutines, ops, 0);
+        measure(numCoroutines, ops, spin);
+    }
+    IOContextMT::stop();
+    IOContextMT::join();
+    return 0;
+}
@@ -0,0 +1,165 @@
+#include <std.hpp>
+#include <awaiter/task.hpp>
+#include <generic/cancel.hpp>
+#include <generic/generic_io.hpp>
+#include <generic/io_context.hpp>
+#include <generic/mutex.hpp>
+#include <platform/platform_io.hpp>
+#include "test_utils.hpp"
+
+/*
+    异步互斥锁的交接语义测试，全部在单个 IOContext 上运行，顺序是确定的：
+    1. 等待者按排队顺序（先进先出）拿到锁，unlock 直接把锁交给队首，新来的 try_lock 不能插队
+    2. 排队中被取消的等待者以 operation_canceled 返回且从未持有锁，后面的等待者不受影响
+    3. 取消了唯一的等待者后 unlock 能把锁真正释放
+    4. 锁已经交给等待者之后才到达的取消不会夺走这把锁
+    5. CallOnce 排队中被取消的等待者以 operation_canceled 返回，其他等待者在完成后拿到空的 Locked
+*/
+
+using namespace zh_async;
+
+// 提交 nop 让出，直到 done() 成立：被 post 回来的协程会在这期间恢复
+template <class F>
+static Task<> yieldUntil(F done) {
+    while (!done()) {
+        (void)co_await UringOp().prep_nop();
+    }
+}
+
+static Task<> orderedWaiter(BasicMutex &mutex, int id, std::vector<int> &events) {
+    auto res = co_await mutex.lock();
+    ZH_ASYNC_CHECK(!res.has_error());
+    events.push_back(id);
+    mutex.unlock();
+}
+
+static Task<> cancelableWaiter(BasicMutex &mutex, CancelToken cancel, int id,
+                               std::vector<int> &events) {
+    auto res = co_await co_cancel.bind(cancel, mutex.lock());
+    if (res.has_error()) {
+        ZH_ASYNC_CHECK(res.error() == std::errc::operation_canceled);
+        events.push_back(-id);
+        co_return;
+    }
+    events.push_back(id);
+    mutex.unlock();
+}
+
+static Task<> testFifoHandoff() {
+    constexpr std::size_t kWaiters = 16;
+    BasicMutex mutex;
+    std::vector<int> events;
+    ZH_ASYNC_CHECK(mutex.try_lock());
+    // co_spawn 立即运行到第一个挂起点，等待者按 spawn 的顺序排队
+    for (std::size_t i = 0; i < kWaiters; ++i) {
+        co_spawn(orderedWaiter(mutex, static_cast<int>(i), events));
+    }
+    ZH_ASYNC_CHECK(events.empty());
+    mutex.unlock();
+    // 锁已经交给了 0 号等待者，它被投递回来之前锁仍处于上锁状态
+    ZH_ASYNC_CHECK(!mutex.try_lock());
+    co_await yieldUntil([&] { return events.size() == kWaiters; });
+    for (std::size_t i = 0; i < kWaiters; ++i) {
+        ZH_ASYNC_CHECK(events[i] == static_cast<int>(i));
+    }
+    ZH_ASYNC_CHECK(mutex.try_lock());
+    mutex.unlock();
+}
+
+static Task<> testCancelWhileQueued() {
+    BasicMutex mutex;
+    CancelSource source;
+    std::vector<int> events;
+    ZH_ASYNC_CHECK(mutex.try_lock());
+    co_spawn(orderedWaiter(mutex, 1, events));
+    co_spawn(cancelableWaiter(mutex, source, 2, events));
+    co_spawn(orderedWaiter(mutex, 3, events));
+    co_await source.cancel();
+    // 被取消的等待者立刻出队并被投递回来，此时锁仍由本协程持有
+    co_await yieldUntil([&] { return !events.empty(); });
+    ZH_ASYNC_CHECK(events == std::vector<int>({-2}));
+    mutex.unlock();
+    co_await yieldUntil([&] { return events.size() == 3; });
+    ZH_ASYNC_CHECK(events == std::vector<int>({-2, 1, 3}));
+    ZH_ASYNC_CHECK(mutex.try_lock());
+    mutex.unlock();
+}
+
+static Task<> testCancelLastWaiter() {
+    BasicMutex mutex;
+    CancelSource source;
+    std::vector<int> events;
+    ZH_ASYNC_CHECK(mutex.try_lock());
+    co_spawn(cancelableWaiter(mutex, source, 1, events));
+    co_await source.cancel();
+    co_await yieldUntil([&] { return !events.empty(); });
+    ZH_ASYNC_CHECK(events == std::vector<int>({-1}));
+    // 等待队列已空，unlock 应当真正释放锁而不是交给一个不存在的等待者
+    mutex.unlock();
+    ZH_ASYNC_CHECK(mutex.try_lock());
+    mutex.unlock();
+}
+
+static Task<> testCancelAfterHandoff() {
+    BasicMutex mutex;
+    CancelSource source;
+    std::vector<int> events;
+    ZH_ASYNC_CHECK(mutex.try_lock());
+    co_spawn(cancelableWaiter(mutex, source, 1, events));
+    mutex.unlock();
+    // 等待者已经出队并拿到锁，只是还没被恢复，这时的取消不应生效
+    co_await source.cancel();
+    co_await yieldUntil([&] { return !events.empty(); });
+    ZH_ASYNC_CHECK(events == std::vector<int>({1}));
+    ZH_ASYNC_CHECK(mutex.try_lock());
+    mutex.unlock();
+}
+
+static Task<> onceWaiter(CallOnce &once, CancelToken cancel, int id,
+                         std::vector<int> &events) {
+    auto res = co_await co_cancel.bind(cancel, once.call_once());
+    if (res.has_error()) {
+        ZH_ASYNC_CHECK(res.error() == std::errc::operation_canceled);
+        events.push_back(-id);
+        co_return;
+    }
+    // 第一个调用者已经完成，这里不需要再初始化
+    ZH_ASYNC_CHECK(!res.value());
+    events.push_back(id);
+}
+
+static Task<> testCallOnceCancel() {
+    CallOnce once;
+    CancelSource source, unused;
+    std::vector<int> events;
+    {
+        auto first = co_await once.call_once();
+        ZH_ASYNC_CHECK(!first.has_error() && first.value());
+        co_spawn(onceWaiter(once, unused, 1, events));
+        co_spawn(onceWaiter(once, source, 2, events));
+        co_await source.cancel();
+        co_await yieldUntil([&] { return !events.empty(); });
+        ZH_ASYNC_CHECK(events == std::vector<int>({-2}));
+        first.value().set_ready();
+    }
+    co_await yieldUntil([&] { return events.size() == 2; });
+    ZH_ASYNC_CHECK(events == std::vector<int>({-2, 1}));
+    auto again = co_await once.call_once();
+    ZH_ASYNC_CHECK(!again.has_error() && !again.value());
+}
+
+static void runTest(Task<> (*test)()) {
+    IOContext ctx;
+    co_spawn(test());
+    ctx.run();
+}
+
+int main() {
+    runTest(testFifoHandoff);
+    runTest(testCancelWhileQueued);
+    runTest(testCancelLastWaiter);
+    runTest(testCancelAfterHandoff);
+    runTest(testCallOnceCancel);
+    std::cout << "mutex_test: ok\n";
+    return 0;
+}
@@ -0,0 +1,145 @@
+#include <std.hpp>
+#include <awaiter/task.hpp>
+#include <generic/cancel.hpp>
+#include <generic/generic_io.hpp>
+#include <generic/io_context.hpp>
+#include <generic/parallel.hpp>
+#include <generic/thread_pool.hpp>
+#include <platform/platform_io.hpp>
+#include "test_utils.hpp"
+
+/*
+    线程池上的并行循环，全部从单个 IOContext 上的协程发起：
+    1. chunk 为 0 的自适应分块和固定分块下，parallel_for 恰好访问每个元素一次，parallel_reduce 的结果与串行一致
+    2. parallel_map 按原顺序收集结果
+    3. 空区间不提交任何执行者，parallel_for 直接成功，parallel_map 返回空，parallel_reduce 返回 init
+    4. 函数体抛出的异常在 co_await 处重新抛出，其他执行者停止领取新块
+    5. 循环进行中取消，已开始的块执行完后返回 operation_canceled，之后的块不再执行
+    用法：parallel_test [元素数] [工作线程数]
+*/
+
+using namespace zh_async;
+
+static std::vector<std::size_t> makeIndices(std::size_t size) {
+    std::vector<std::size_t> indices(size);
+    std::iota(indices.begin(), indices.end(), std::size_t(0));
+    return indices;
+}
+
+template <class F>
+static Task<> yieldUntil(F done) {
+    while (!done()) {
+        (void)co_await UringOp().prep_nop();
+    }
+}
+
+static Task<> testCoverage(Thread_pool &pool, std::size_t size) {
+    std::vector<std::size_t> values(size);
+    std::iota(values.begin(), values.end(), std::size_t(1));
+    std::size_t expected = size * (size + 1) / 2;
+    for (std::size_t chunk: {std::size_t(0), std::size_t(1), std::size_t(7), size}) {
+        std::vector<std::atomic<int>> visits(size);
+        auto res = co_await parallel_for(pool, values, chunk, [&](std::size_t &v) {
+            visits[v - 1].fetch_add(1, std::memory_order_relaxed);
+        });
+        ZH_ASYNC_CHECK(!res.has_error());
+        ZH_ASYNC_CHECK(std::ranges::all_of(
+            visits, [](std::atomic<int> const &n) { return n.load() == 1; }));
+        auto sum = co_await parallel_reduce(pool, values, chunk, std::size_t(0),
+                                            std::plus<>());
+        ZH_ASYNC_CHECK(!sum.has_error() && sum.value() == expected);
+    }
+}
+
+static Task<> testMapOrder(Thread_pool &pool, std::size_t size) {
+    auto indices = makeIndices(size);
+    for (std::size_t chunk: {std::size_t(0), std::size_t(3)}) {
+        auto out = co_await parallel_map(pool, indices, chunk,
+                                         [](std::size_t i) { return i * i; });
+        ZH_ASYNC_CHECK(!out.has_error());
+        auto &squares = out.value();
+        ZH_ASYNC_CHECK(squares.size() == size);
+        for (std::size_t i = 0; i < size; ++i) {
+            ZH_ASYNC_CHECK(squares[i] == i * i);
+        }
+    }
+}
+
+static Task<> testEmpty(Thread_pool &pool) {
+    std::vector<int> empty;
+    bool called = false;
+    auto res = co_await parallel_for(pool, empty, 0, [&](int) { called = true; });
+    ZH_ASYNC_CHECK(!res.has_error() && !called);
+    auto out = co_await parallel_map(pool, empty, 0, [](int v) { return v; });
+    ZH_ASYNC_CHECK(!out.has_error() && out.value().empty());
+    auto sum = co_await parallel_reduce(pool, empty, 0, 42, std::plus<>());
+    ZH_ASYNC_CHECK(!sum.has_error() && sum.value() == 42);
+}
+
+static Task<> testException(Thread_pool &pool, std::size_t size) {
+    auto indices = makeIndices(size);
+    std::atomic<std::size_t> visited{0};
+    bool thrown = false;
+    try {
+        (void)co_await parallel_for(pool, indices, 1, [&](std::size_t i) {
+            visited.fetch_add(1, std::memory_order_relaxed);
+            if (i == 0) {
+                throw std::runtime_error("parallel_test");
+            }
+        });
+    } catch (std::runtime_error const &e) {
+        thrown = std::string_view(e.what()) == "parallel_test";
+    }
+    ZH_ASYNC_CHECK(thrown);
+    // 抛出后其他执行者各自最多再执行完手上的一块
+    ZH_ASYNC_CHECK(visited.load() < size);
+}
+
+static Task<> cancelableLoop(Thread_pool &pool, std::size_t size, CancelToken cancel,
+                             std::atomic<std::size_t> &started,
+                             std::atomic<bool> &gate, std::optional<Expected<>> &result) {
+    auto indices = makeIndices(size);
+    result = co_await co_cancel.bind(
+        cancel, parallel_for(pool, indices, 1, [&](std::size_t) {
+            started.fetch_add(1, std::memory_order_relaxed);
+            gate.wait(false);
+        }));
+}
+
+static Task<> testCancel(Thread_pool &pool, std::size_t size) {
+    CancelSource source;
+    std::atomic<std::size_t> started{0};
+    std::atomic<bool> gate{false};
+    std::optional<Expected<>> result;
+    co_spawn(cancelableLoop(pool, size, source, started, gate, result));
+    // 等至少一个执行者堵在第一块上再取消
+    co_await yieldUntil([&] { return started.load() != 0; });
+    co_await source.cancel();
+    gate.store(true);
+    gate.notify_all();
+    co_await yieldUntil([&] { return result.has_value(); });
+    ZH_ASYNC_CHECK(result->has_error() &&
+                   result->error() == std::errc::operation_canceled);
+    ZH_ASYNC_CHECK(started.load() <= pool.threads_count());
+}
+
+static void runTest(Thread_pool &pool, std::size_t size,
+                    Task<> (*test)(Thread_pool &, std::size_t)) {
+    IOContext ctx;
+    co_spawn(test(pool, size));
+    ctx.run();
+}
+
+int main(int argc, char **argv) {
+    std::size_t size = test::arg_or(argc, argv, 1, 100000);
+    std::size_t numWorkers = test::arg_or(argc, argv, 2, 4);
+
+    Thread_pool pool(numWorkers);
+    runTest(pool, size, testCoverage);
+    runTest(pool, size, testMapOrder);
+    runTest(pool, size, [](Thread_pool &pool, std::size_t) { return testEmpty(pool); });
+    runTest(pool, size, testException);
+    runTest(pool, size, testCancel);
+    std::cout << "parallel_test: ok\n";
+    return 0;
+}
@@ -0,0 +1,154 @@
+#include <std.hpp>
+#include <awaiter/task.hpp>
+#include <generic/generic_io.hpp>
+#include <generic/io_context.hpp>
+#include <generic/io_context_mt.hpp>
+#include <generic/queue.hpp>
+#include <platform/platform_io.hpp>
+#include "test_utils.hpp"
+
+/*
+    批量接口相对逐个操作的加速比：
+    1. 单线程、无人等待：Queue / ConcurrentQueue 每轮压入再取出 batch 个元素，
+       逐个 try_push / try_pop 与一次 try_push_bulk / try_pop_bulk 对比
+    2. 跨线程：生产者和消费者协程各占一个 worker，经 ConcurrentQueue 传递 N 个元素，
+       逐个 co_await push / pop 与按 batch 成批 push_bulk / pop_bulk 对比（唤醒次数随批量摊薄）
+    用法：queue_bulk_bench [元素数] [批量大小] [队列容量]
+*/
+
+using namespace zh_async;
+
+static void printSpeedup(std::string_view name, double singleNs, double bulkNs) {
+    std::cout << name << " bulk speedup: " << std::fixed << std::setprecision(2)
+              << singleNs / std::max(bulkNs, 1.0) << "x\n";
+}
+
+template <class Q>
+static void benchLocal(std::string_view name, std::size_t numItems,
+                       std::size_t batch, std::size_t capacity) {
+    Q queue(capacity);
+    std::size_t rounds = std::max<std::size_t>(numItems / batch, 1);
+    std::vector<std::size_t> values(batch), out;
+    out.reserve(batch);
+
+    std::size_t sum = 0;
+    double singleNs = test::time_ns([&] {
+        for (std::size_t r = 0; r < rounds; ++r) {
+            for (std::size_t i = 0; i < batch; ++i) {
+                ZH_ASYNC_CHECK(queue.try_push(std::size_t(i)));
+            }
+            for (std::size_t i = 0; i < batch; ++i) {
+                sum += *queue.try_pop();
+            }
+        }
+    });
+    double bulkNs = test::time_ns([&] {
+        for (std::size_t r = 0; r < rounds; ++r) {
+            std::iota(values.begin(), values.end(), std::size_t(0));
+            ZH_ASYNC_CHECK(queue.try_push_bulk(std::span(values)) == batch);
+            out.clear();
+            ZH_ASYNC_CHECK(queue.try_pop_bulk(std::back_inserter(out), batch) == batch);
+            for (std::size_t value: out) {
+                sum -= value;
+            }
+        }
+    });
+    ZH_ASYNC_CHECK(sum == 0);
+    test::report(std::string(name) + " single", rounds * batch, singleNs);
+    test::report(std::string(name) + " bulk", rounds * batch, bulkNs);
+    printSpeedup(name, singleNs, bulkNs);
+}
+
+static std::atomic<std::size_t> gRemaining{0};
+
+static void finish() {
+    if (gRemaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        gRemaining.notify_all();
+    }
+}
+
+static Task<> singleProducer(ConcurrentQueue<std::size_t> &queue, std::size_t count) {
+    for (std::size_t i = 0; i < count; ++i) {
+        auto res = co_await queue.push(i);
+        ZH_ASYNC_CHECK(!res.has_error());
+    }
+    finish();
+}
+
+static Task<> singleConsumer(ConcurrentQueue<std::size_t> &queue, std::size_t count) {
+    for (std::size_t i = 0; i < count; ++i) {
+        auto res = co_await queue.pop();
+        ZH_ASYNC_CHECK(!res.has_error());
+    }
+    finish();
+}
+
+static Task<> bulkProducer(ConcurrentQueue<std::size_t> &queue, std::size_t count,
+                           std::size_t batch) {
+    std::vector<std::size_t> values(batch);
+    for (std::size_t i = 0; i < count; i += batch) {
+        std::size_t n = std::min(batch, count - i);
+        std::iota(values.begin(), values.begin() + static_cast<std::ptrdiff_t>(n), i);
+        auto res = co_await queue.push_bulk(std::span(values.data(), n));
+        ZH_ASYNC_CHECK(!res.has_error());
+    }
+    finish();
+}
+
+static Task<> bulkConsumer(ConcurrentQueue<std::size_t> &queue, std::size_t count,
+                           std::size_t batch) {
+    std::vector<std::size_t> out;
+    out.reserve(batch);
+    for (std::size_t got = 0; got < count;) {
+        out.clear();
+        auto res = co_await queue.pop_bulk(std::back_inserter(out), batch);
+        ZH_ASYNC_CHECK(!res.has_error());
+        got += out.size();
+    }
+    finish();
+}
+
+template <class F>
+static double runPair(F spawnBoth) {
+    IOContextMT mt;
+    IOContextMT::start(IOContextMTOptions{.numWorkers = 2});
+    gRemaining.store(2);
+    double ns = test::time_ns([&] {
+        spawnBoth();
+        while (std::size_t n = gRemaining.load(std::memory_order_acquire)) {
+            gRemaining.wait(n);
+        }
+    });
+    IOContextMT::stop();
+    IOContextMT::join();
+    return ns;
+}
+
+static void benchCrossThread(std::size_t numItems, std::size_t batch,
+                             std::size_t capacity) {
+    ConcurrentQueue<std::size_t> queue(capacity);
+    double singleNs = runPair([&] {
+        co_spawn(IOContextMT::nth_worker(1), singleConsumer(queue, numItems));
+        co_spawn(IOContextMT::nth_worker(0), singleProducer(queue, numItems));
+    });
+    double bulkNs = runPair([&] {
+        co_spawn(IOContextMT::nth_worker(1), bulkConsumer(queue, numItems, batch));
+        co_spawn(IOContextMT::nth_worker(0), bulkProducer(queue, numItems, batch));
+    });
+    ZH_ASYNC_CHECK(!queue.try_pop());
+    test::report("ConcurrentQueue cross-thread single", numItems, singleNs);
+    test::report("ConcurrentQueue cross-thread bulk", numItems, bulkNs);
+    printSpeedup("ConcurrentQueue cross-thread", singleNs, bulkNs);
+}
+
+int main(int argc, char **argv) {
+    std::size_t numItems = test::arg_or(argc, argv, 1, 1000000);
+    std::size_t batch = std::max<std::size_t>(test::arg_or(argc, argv, 2, 32), 1);
+    std::size_t capacity = std::max(test::arg_or(argc, argv, 3, 1024), batch + 1);
+
+    benchLocal<Queue<std::size_t>>("Queue", numItems, batch, capacity);
+    benchLocal<ConcurrentQueue<std::size_t>>("ConcurrentQueue", numItems, batch,
+                                             capacity);
+    benchCrossThread(numItems, batch, capacity);
+    return 0;
+}
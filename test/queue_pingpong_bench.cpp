@@ -0,0 +1,61 @@
+#include <std.hpp>
+#include <awaiter/task.hpp>
+#include <generic/generic_io.hpp>
+#include <generic/io_context.hpp>
+#include <generic/queue.hpp>
+#include <platform/platform_io.hpp>
+#include "test_utils.hpp"
+
+/*
+    单个 IOContext 上两个协程经一对容量为 1 的队列来回传递一个计数 N 次，
+    每次往返都要挂起、被对方唤醒各两次，唤醒全部走本线程的投递，不经过收件箱和门铃，也不进内核
+    Queue 与 ConcurrentQueue 各跑一遍，统计往返吞吐和单次往返的延迟分布
+    用法：queue_pingpong_bench [往返次数]
+*/
+
+using namespace zh_async;
+
+template <class Q>
+static Task<> pinger(Q &ping, Q &pong, std::size_t rounds,
+                     test::LatencyHistogram &histogram) {
+    for (std::size_t i = 0; i < rounds; ++i) {
+        auto t0 = std::chrono::steady_clock::now();
+        auto pushed = co_await ping.push(i);
+        ZH_ASYNC_CHECK(!pushed.has_error());
+        auto value = co_await pong.pop();
+        ZH_ASYNC_CHECK(!value.has_error() && value.value() == i);
+        histogram.add(std::chrono::steady_clock::now() - t0);
+    }
+}
+
+template <class Q>
+static Task<> ponger(Q &ping, Q &pong, std::size_t rounds) {
+    for (std::size_t i = 0; i < rounds; ++i) {
+        auto value = co_await ping.pop();
+        ZH_ASYNC_CHECK(!value.has_error() && value.value() == i);
+        auto pushed = co_await pong.push(value.value());
+        ZH_ASYNC_CHECK(!pushed.has_error());
+    }
+}
+
+template <class Q>
+static void bench(std::string_view name, std::size_t rounds) {
+    IOContext ctx;
+    Q ping(1), pong(1);
+    test::LatencyHistogram histogram;
+    histogram.samples.reserve(rounds);
+    co_spawn(ponger(ping, pong, rounds));
+    co_spawn(pinger(ping, pong, rounds, histogram));
+    double ns = test::time_ns([&] { ctx.run(); });
+    ZH_ASYNC_CHECK(histogram.samples.size() == rounds);
+    test::report(std::string(name) + " round trip", rounds, ns);
+    histogram.print(std::string(name) + " round trip");
+}
+
+int main(int argc, char **argv) {
+    std::size_t rounds = test::arg_or(argc, argv, 1, 1000000);
+
+    bench<Queue<std::size_t>>("Queue", rounds);
+    bench<ConcurrentQueue<std::size_t>>("ConcurrentQueue", rounds);
+    return 0;
+}
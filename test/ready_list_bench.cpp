@@ -0,0 +1,65 @@
+#include <std.hpp>
+#include <awaiter/task.hpp>
+#include <generic/generic_io.hpp>
+#include <generic/io_context.hpp>
+#include <platform/platform_io.hpp>
+#include "test_utils.hpp"
+
+/*
+    收割完成事件的零分配基准：
+    fanout 个协程各自循环提交 nop 并等待完成，稳态下每轮 waitEventsFor 收割一批 CQE 并恢复对应的协程
+    全局 operator new 被替换为计数版本，启动协程之后到事件循环退出之间不应有任何堆分配
+    用法：ready_list_bench [总操作数] [并发协程数]
+*/
+
+static std::atomic<std::size_t> gNumAllocs{0};
+
+void *operator new(std::size_t size) {
+    gNumAllocs.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+using namespace zh_async;
+
+static Task<> nopLoop(std::size_t count) {
+    for (std::size_t i = 0; i < count; ++i) {
+        (void)co_await UringOp().prep_nop();
+    }
+}
+
+int main(int argc, char **argv) {
+    std::size_t numOps = test::arg_or(argc, argv, 1, 1000000);
+    std::size_t fanout = std::max<std::size_t>(test::arg_or(argc, argv, 2, 64), 1);
+    std::size_t perTask = std::max<std::size_t>(numOps / fanout, 1);
+
+    IOContext ctx;
+    // 预热：让完成队列、帧池等都进入稳定状态
+    for (std::size_t i = 0; i < fanout; ++i) {
+        co_spawn(nopLoop(16));
+    }
+    ctx.run();
+
+    for (std::size_t i = 0; i < fanout; ++i) {
+        co_spawn(nopLoop(perTask));
+    }
+    // 只统计启动之后的分配：协程帧在 co_spawn 时已经分配好
+    gNumAllocs.store(0, std::memory_order_relaxed);
+    double ns = test::time_ns([&] { ctx.run(); });
+    std::size_t allocs = gNumAllocs.load(std::memory_order_relaxed);
+
+    test::report("nop submit + reap", perTask * fanout, ns);
+    std::cout << "heap allocations while reaping: " << allocs << '\n';
+    ZH_ASYNC_CHECK(allocs == 0);
+    return 0;
+}
@@ -0,0 +1,141 @@
+#include <std.hpp>
+#include <utils/ring_queue.hpp>
+#include "test_utils.hpp"
+
+/*
+    RingQueue 的回绕回归测试，重点是批量操作跨过缓冲区末尾的情况：
+    RingQueue(n) 留一个空槽区分满和空，最多存放 n - 1 个元素
+    对每个容量、每个起始偏移做 push_bulk / pop_bulk，再用随机操作序列与 std::deque 对照，
+    每一步都检查 size / empty / full 与内容一致
+*/
+
+using namespace zh_async;
+
+static void checkSame(RingQueue<int> const &queue, std::deque<int> const &model,
+                      std::size_t capacity) {
+    ZH_ASYNC_CHECK(queue.size() == model.size());
+    ZH_ASYNC_CHECK(queue.empty() == model.empty());
+    ZH_ASYNC_CHECK(queue.full() == (model.size() == capacity - 1));
+}
+
+// 从每个起始偏移开始，一次批量压满再一次批量取空
+static void testBulkAtEveryOffset() {
+    for (std::size_t capacity = 2; capacity <= 9; ++capacity) {
+        for (std::size_t offset = 0; offset < capacity; ++offset) {
+            for (std::size_t batch = 0; batch <= capacity + 1; ++batch) {
+                RingQueue<int> queue(capacity);
+                for (std::size_t i = 0; i < offset; ++i) {
+                    ZH_ASYNC_CHECK(queue.push(-1));
+                    ZH_ASYNC_CHECK(queue.pop() == -1);
+                }
+                std::vector<int> values(batch);
+                std::iota(values.begin(), values.end(), 0);
+                std::size_t pushed = queue.push_bulk(std::span(values));
+                ZH_ASYNC_CHECK(pushed == std::min(batch, capacity - 1));
+                ZH_ASYNC_CHECK(queue.size() == pushed);
+                ZH_ASYNC_CHECK(queue.full() == (pushed == capacity - 1));
+
+                std::vector<int> out;
+                ZH_ASYNC_CHECK(queue.pop_bulk(std::back_inserter(out),
+                                              capacity + 1) == pushed);
+                ZH_ASYNC_CHECK(queue.empty());
+                for (std::size_t i = 0; i < pushed; ++i) {
+                    ZH_ASYNC_CHECK(out[i] == static_cast<int>(i));
+                }
+            }
+        }
+    }
+}
+
+// 随机交错单个和批量操作，与 std::deque 对照
+static void testRandomAgainstDeque() {
+    std::mt19937 rng(7);
+    for (std::size_t capacity: {2, 3, 7, 8, 33}) {
+        RingQueue<int> queue(capacity);
+        std::deque<int> model;
+        int next = 0;
+        for (int step = 0; step < 20000; ++step) {
+            switch (rng() % 4) {
+            case 0: {
+                bool ok = queue.push(int(next));
+                ZH_ASYNC_CHECK(ok == (model.size() < capacity - 1));
+                if (ok) {
+                    model.push_back(next++);
+                }
+                break;
+            }
+            case 1: {
+                auto value = queue.pop();
+                ZH_ASYNC_CHECK(value.has_value() == !model.empty());
+                if (value) {
+                    ZH_ASYNC_CHECK(*value == model.front());
+                    model.pop_front();
+                }
+                break;
+            }
+            case 2: {
+                std::vector<int> values(rng() % (capacity + 2));
+                for (auto &value: values) {
+                    value = next++;
+                }
+                std::size_t pushed = queue.push_bulk(std::span(values));
+                ZH_ASYNC_CHECK(pushed ==
+                               std::min(values.size(), capacity - 1 - model.size()));
+                model.insert(model.end(), values.begin(),
+                             values.begin() + static_cast<std::ptrdiff_t>(pushed));
+                break;
+            }
+            default: {
+                std::size_t maxCount = rng() % (capacity + 2);
+                std::vector<int> out;
+                std::size_t popped =
+                    queue.pop_bulk(std::back_inserter(out), maxCount);
+                ZH_ASYNC_CHECK(popped == std::min(maxCount, model.size()));
+                for (int value: out) {
+                    ZH_ASYNC_CHECK(value == model.front());
+                    model.pop_front();
+                }
+                break;
+            }
+            }
+            checkSame(queue, model, capacity);
+        }
+    }
+}
+
+// 只压入一部分时，span 里剩下的元素不能被移动走
+static void testPartialBulkKeepsRest() {
+    RingQueue<std::unique_ptr<int>> queue(4);
+    ZH_ASYNC_CHECK(queue.push(std::make_unique<int>(0)));
+    ZH_ASYNC_CHECK(queue.pop());
+    std::vector<std::unique_ptr<int>> values;
+    for (int i = 0; i < 5; ++i) {
+        values.push_back(std::make_unique<int>(i));
+    }
+    ZH_ASYNC_CHECK(queue.push_bulk(std::span(values)) == 3);
+    ZH_ASYNC_CHECK(!values[2] && values[3] && *values[3] == 3 && *values[4] == 4);
+    std::vector<std::unique_ptr<int>> out;
+    ZH_ASYNC_CHECK(queue.pop_bulk(std::back_inserter(out), 10) == 3);
+    for (int i = 0; i < 3; ++i) {
+        ZH_ASYNC_CHECK(*out[static_cast<std::size_t>(i)] == i);
+    }
+}
+
+// 容量为 0 的队列不能存放任何元素
+static void testZeroCapacity() {
+    RingQueue<int> queue;
+    ZH_ASYNC_CHECK(queue.full() && queue.empty());
+    ZH_ASYNC_CHECK(!queue.push(1));
+    int values[2] = {1, 2};
+    ZH_ASYNC_CHECK(queue.push_bulk(std::span(values)) == 0);
+    ZH_ASYNC_CHECK(queue.pop_bulk(values, 2) == 0);
+}
+
+int main() {
+    testBulkAtEveryOffset();
+    testRandomAgainstDeque();
+    testPartialBulkKeepsRest();
+    testZeroCapacity();
+    std::cout << "ring_queue_test: ok\n";
+    return 0;
+}
@@ -0,0 +1,147 @@
+#include <std.hpp>
+#include <awaiter/task.hpp>
+#include <generic/generic_io.hpp>
+#include <generic/io_context.hpp>
+#include <generic/io_context_mt.hpp>
+#include <generic/spsc_channel.hpp>
+#include <platform/platform_io.hpp>
+#include "test_utils.hpp"
+
+/*
+    单生产者单消费者通道的测试：
+    1. 单线程：容量向上取整到 2 的幂；满时 try_push 失败、try_push_bulk 只压入剩余空位；
+       空时 try_pop / try_pop_bulk 取不到；读写位置多次回绕后元素仍按顺序取出
+    2. 跨线程：生产者和消费者各占一个 worker，经小容量通道传递 N 个递增的数，
+       生产者轮流用 push 和比容量还大的 push_bulk，消费者轮流用 pop 和 pop_bulk，
+       一方周期性地停顿让另一方撞上满/空并挂起，消费者收到的序列必须完整且有序
+    用法：spsc_channel_test [元素数] [通道容量]
+*/
+
+using namespace zh_async;
+
+static void testLocal() {
+    SpscChannel<std::size_t> channel(5);
+    ZH_ASYNC_CHECK(channel.max_size() == 8);
+    ZH_ASYNC_CHECK(!channel.try_pop());
+
+    std::size_t next = 0, expected = 0;
+    std::vector<std::size_t> values(5), more(8), out;
+    for (std::size_t round = 0; round < 10; ++round) {
+        // 每轮写入 8 + 6 个、读出同样多，读写位置每轮都跨过缓冲区末尾
+        for (std::size_t i = 0; i < 3; ++i) {
+            ZH_ASYNC_CHECK(channel.try_push(std::size_t(next++)));
+        }
+        std::iota(values.begin(), values.end(), next);
+        ZH_ASYNC_CHECK(channel.try_push_bulk(std::span(values)) == 5);
+        next += 5;
+        ZH_ASYNC_CHECK(channel.size() == 8);
+        ZH_ASYNC_CHECK(!channel.try_push(std::size_t(next)));
+        ZH_ASYNC_CHECK(channel.try_push_bulk(std::span(values)) == 0);
+
+        out.clear();
+        ZH_ASYNC_CHECK(channel.try_pop_bulk(std::back_inserter(out), 6) == 6);
+        std::iota(more.begin(), more.end(), next);
+        ZH_ASYNC_CHECK(channel.try_push_bulk(std::span(more)) == 6);
+        next += 6;
+        ZH_ASYNC_CHECK(channel.try_pop_bulk(std::back_inserter(out), 100) == 8);
+        for (std::size_t value: out) {
+            ZH_ASYNC_CHECK(value == expected++);
+        }
+        ZH_ASYNC_CHECK(channel.empty());
+        ZH_ASYNC_CHECK(channel.try_pop_bulk(std::back_inserter(out), 1) == 0);
+    }
+}
+
+static std::atomic<std::size_t> gRemaining{0};
+
+static void finish() {
+    if (gRemaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        gRemaining.notify_all();
+    }
+}
+
+// 每隔 stride 次操作停顿一下，让对端撞上满或空
+static void stall(std::size_t step, std::size_t stride) {
+    if (step % stride == 0) {
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+}
+
+static Task<> producer(SpscChannel<std::size_t> &channel, std::size_t count,
+                       std::size_t stride) {
+    std::size_t capacity = channel.max_size();
+    std::vector<std::size_t> values;
+    std::size_t i = 0, step = 0;
+    while (i < count) {
+        if (step++ % 2 == 0) {
+            auto res = co_await channel.push(std::size_t(i++));
+            ZH_ASYNC_CHECK(!res.has_error());
+        } else {
+            // 批量大小在 1 到 2 倍容量之间变化，超过容量的一批要中途等消费者腾位置
+            std::size_t n = std::min(1 + step % (2 * capacity), count - i);
+            values.resize(n);
+            std::iota(values.begin(), values.end(), i);
+            auto res = co_await channel.push_bulk(std::span(values));
+            ZH_ASYNC_CHECK(!res.has_error());
+            i += n;
+        }
+        if (count / 2 <= i) {
+            stall(step, stride);
+        }
+    }
+    finish();
+}
+
+static Task<> consumer(SpscChannel<std::size_t> &channel, std::size_t count,
+                       std::size_t stride) {
+    std::size_t capacity = channel.max_size();
+    std::vector<std::size_t> out;
+    std::size_t expected = 0, step = 0;
+    while (expected < count) {
+        if (step++ % 2 == 0) {
+            auto res = co_await channel.pop();
+            ZH_ASYNC_CHECK(!res.has_error() && res.value() == expected);
+            ++expected;
+        } else {
+            out.clear();
+            auto res = co_await channel.pop_bulk(std::back_inserter(out),
+                                                 1 + step % (2 * capacity));
+            ZH_ASYNC_CHECK(!res.has_error() && res.value() == out.size());
+            for (std::size_t value: out) {
+                ZH_ASYNC_CHECK(value == expected++);
+            }
+        }
+        // 前一半由消费者停顿，生产者撞上满；后一半由生产者停顿，消费者撞上空
+        if (expected < count / 2) {
+            stall(step, stride);
+        }
+    }
+    ZH_ASYNC_CHECK(expected == count);
+    finish();
+}
+
+static void testCrossThread(std::size_t count, std::size_t capacity) {
+    SpscChannel<std::size_t> channel(capacity);
+    std::size_t stride = 64;
+    IOContextMT mt;
+    IOContextMT::start(IOContextMTOptions{.numWorkers = 2});
+    gRemaining.store(2);
+    co_spawn(IOContextMT::nth_worker(1), consumer(channel, count, stride));
+    co_spawn(IOContextMT::nth_worker(0), producer(channel, count, stride));
+    while (std::size_t n = gRemaining.load(std::memory_order_acquire)) {
+        gRemaining.wait(n);
+    }
+    IOContextMT::stop();
+    IOContextMT::join();
+    ZH_ASYNC_CHECK(channel.empty());
+}
+
+int main(int argc, char **argv) {
+    std::size_t count = test::arg_or(argc, argv, 1, 1000000);
+    std::size_t capacity = test::arg_or(argc, argv, 2, 16);
+
+    testLocal();
+    testCrossThread(count, capacity);
+    std::cout << "spsc_channel_test: ok\n";
+    return 0;
+}
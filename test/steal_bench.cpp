@@ -0,0 +1,80 @@
+#include <std.hpp>
+#include <awaiter/task.hpp>
+#include <generic/generic_io.hpp>
+#include <generic/io_context.hpp>
+#include <generic/io_context_mt.hpp>
+#include <platform/platform_io.hpp>
+#include "test_utils.hpp"
+
+/*
+    倾斜负载下的工作窃取基准：
+    所有协程都投递到 0 号 worker，每个协程反复做一段计算再提交一个 nop 让出
+    开启 ZH_ASYNC_STEAL 时空闲的 worker 会从 0 号的运行队列偷走积压的协程，
+    对比开启前后的总耗时和各 worker 实际执行的轮数分布
+    用法：steal_bench [协程数] [worker 数] [每个协程的轮数] [每轮的计算量]
+*/
+
+using namespace zh_async;
+
+static std::atomic<std::size_t> gRemaining{0};
+static std::unique_ptr<std::atomic<std::size_t>[]> gRounds;
+
+static void burn(std::size_t amount) {
+    std::size_t x = 0;
+    for (std::size_t i = 0; i < amount; ++i) {
+        x += i * i;
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+    }
+    (void)x;
+}
+
+static Task<> skewedTask(std::size_t rounds, std::size_t work) {
+    for (std::size_t r = 0; r < rounds; ++r) {
+        burn(work);
+        gRounds[IOContextMT::this_worker_id()].fetch_add(
+            1, std::memory_order_relaxed);
+        (void)co_await UringOp().prep_nop();
+    }
+    if (gRemaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        gRemaining.notify_all();
+    }
+}
+
+int main(int argc, char **argv) {
+    std::size_t numTasks = test::arg_or(argc, argv, 1, 256);
+    std::size_t numWorkers = test::arg_or(
+        argc, argv, 2, std::max<std::size_t>(std::thread::hardware_concurrency(), 2));
+    std::size_t rounds = test::arg_or(argc, argv, 3, 64);
+    std::size_t work = test::arg_or(argc, argv, 4, 20000);
+
+    IOContextMT mt;
+    IOContextMT::start(IOContextMTOptions{.numWorkers = numWorkers});
+    gRounds = std::make_unique<std::atomic<std::size_t>[]>(numWorkers + 1);
+    gRemaining.store(numTasks);
+
+    double ns = test::time_ns([&] {
+        for (std::size_t i = 0; i < numTasks; ++i) {
+            co_spawn(IOContextMT::nth_worker(0), skewedTask(rounds, work));
+        }
+        while (std::size_t n = gRemaining.load(std::memory_order_acquire)) {
+            gRemaining.wait(n);
+        }
+    });
+    IOContextMT::stop();
+    IOContextMT::join();
+
+#if ZH_ASYNC_STEAL
+    std::cout << "work stealing: on\n";
+#else
+    std::cout << "work stealing: off\n";
+#endif
+    std::size_t total = 0;
+    for (std::size_t i = 0; i < numWorkers; ++i) {
+        std::size_t n = gRounds[i].load();
+        total += n;
+        std::cout << "worker " << i << ": " << n << " rounds\n";
+    }
+    test::report("skewed rounds (all spawned on worker 0)", total, ns);
+    ZH_ASYNC_CHECK(total == numTasks * rounds);
+    return 0;
+}
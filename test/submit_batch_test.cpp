@@ -0,0 +1,127 @@
+#include <std.hpp>
+#include <awaiter/task.hpp>
+#include <generic/generic_io.hpp>
+#include <generic/io_context.hpp>
+#include <platform/platform_io.hpp>
+#include "test_utils.hpp"
+
+/*
+    SubmitBatch 的边界测试，全部在单个 IOContext 上运行：
+    1. 批内准备的 SQE 超过构造时预留的个数时抛出 std::length_error，已准备的操作不受影响
+    2. link 为 true 时中间的操作失败，后面的操作以 -ECANCELED 结束
+    3. drain 为 true 时批内的操作等之前提交的定时器完成后才开始
+    4. 创建批的协程在作用域内挂起时，事件循环提前结束这个批而不是一直等它提交
+*/
+
+using namespace zh_async;
+
+template <class F>
+static Task<> yieldUntil(F done) {
+    while (!done()) {
+        (void)co_await UringOp().prep_nop();
+    }
+}
+
+static Task<> nopOp(std::vector<int> &results, std::size_t i) {
+    results[i] = co_await UringOp().prep_nop();
+}
+
+static Task<> closeOp(std::vector<int> &results, std::size_t i, int fd) {
+    results[i] = co_await UringOp().prep_close(fd);
+}
+
+static Task<> timeoutOp(std::vector<int> &order, int id,
+                        std::chrono::milliseconds delay) {
+    auto ts = durationToKernelTimespec(delay);
+    (void)co_await UringOp().prep_timeout(&ts, 0, 0);
+    order.push_back(id);
+}
+
+static Task<> nopThen(std::vector<int> &order, int id) {
+    (void)co_await UringOp().prep_nop();
+    order.push_back(id);
+}
+
+static Task<> testOverReserve() {
+    std::vector<int> results(3, -ENOSYS);
+    bool thrown = false;
+    {
+        SubmitBatch batch(2);
+        co_spawn(nopOp(results, 0));
+        co_spawn(nopOp(results, 1));
+        ZH_ASYNC_CHECK(batch.size() == 2);
+        // 异常从 UringOp 的构造函数抛出，在 co_await 挂起之前
+        try {
+            (void)co_await UringOp().prep_nop();
+        } catch (std::length_error const &) {
+            thrown = true;
+        }
+        ZH_ASYNC_CHECK(batch.size() == 2);
+    }
+    ZH_ASYNC_CHECK(thrown);
+    co_await yieldUntil(
+        [&] { return results[0] != -ENOSYS && results[1] != -ENOSYS; });
+    ZH_ASYNC_CHECK(results[0] == 0 && results[1] == 0);
+    // 批结束后照常提交
+    co_spawn(nopOp(results, 2));
+    co_await yieldUntil([&] { return results[2] != -ENOSYS; });
+    ZH_ASYNC_CHECK(results[2] == 0);
+}
+
+static Task<> testLink() {
+    std::vector<int> results(3, -ENOSYS);
+    {
+        SubmitBatch batch(3, /*link=*/true);
+        co_spawn(nopOp(results, 0));
+        co_spawn(closeOp(results, 1, -1));
+        co_spawn(nopOp(results, 2));
+    }
+    co_await yieldUntil([&] {
+        return std::ranges::none_of(results, [](int r) { return r == -ENOSYS; });
+    });
+    ZH_ASYNC_CHECK(results[0] == 0);
+    ZH_ASYNC_CHECK(results[1] == -EBADF);
+    ZH_ASYNC_CHECK(results[2] == -ECANCELED);
+}
+
+static Task<> testDrain() {
+    std::vector<int> order;
+    co_spawn(timeoutOp(order, 1, std::chrono::milliseconds(20)));
+    {
+        SubmitBatch batch(1, /*link=*/false, /*drain=*/true);
+        co_spawn(nopThen(order, 2));
+    }
+    co_await yieldUntil([&] { return order.size() == 2; });
+    ZH_ASYNC_CHECK(order == std::vector<int>({1, 2}));
+}
+
+static Task<> testSuspendInside() {
+    std::vector<int> results(3, -ENOSYS);
+    SubmitBatch batch(2);
+    co_spawn(nopOp(results, 0));
+    // 批还没结束就挂起，事件循环进入等待前提交已准备的 SQE
+    results[1] = co_await UringOp().prep_nop();
+    ZH_ASYNC_CHECK(results[1] == 0);
+    co_await yieldUntil([&] { return results[0] != -ENOSYS; });
+    ZH_ASYNC_CHECK(results[0] == 0);
+    // 批已被提前结束，之后的 SQE 不再受预留个数限制
+    co_spawn(nopOp(results, 2));
+    co_await yieldUntil([&] { return results[2] != -ENOSYS; });
+    ZH_ASYNC_CHECK(results[2] == 0);
+    ZH_ASYNC_CHECK(batch.size() == 2);
+}
+
+static void runTest(Task<> (*test)()) {
+    IOContext ctx;
+    co_spawn(test());
+    ctx.run();
+}
+
+int main() {
+    runTest(testOverReserve);
+    runTest(testLink);
+    runTest(testDrain);
+    runTest(testSuspendInside);
+    std::cout << "submit_batch_test: ok\n";
+    return 0;
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <std.hpp>
+
+/*
+    test/ 下的测试和基准测试共用的小工具，不依赖任何测试框架
+    每个 .cpp 是一个独立的可执行文件，检查失败时打印位置并以非零状态退出，供 ctest 判断
+    基准测试的规模可以通过第一个命令行参数调整，ctest 里用较小的规模只做冒烟测试
+*/
+
+#define ZH_ASYNC_CHECK(cond)                                                   \
+    do {                                                                       \
+        if (!(cond)) [[unlikely]] {                                            \
+            std::cerr << __FILE__ << ':' << __LINE__                           \
+                      << ": check failed: " #cond "\n";                       \
+            std::exit(1);                                                      \
+        }                                                                      \
+    } while (0)
+
+namespace zh_async::test {
+// 第 index 个命令行参数解析为整数，不存在时返回默认值
+inline std::size_t arg_or(int argc, char **argv, int index,
+                          std::size_t fallback) {
+    if (index < argc) {
+        return static_cast<std::size_t>(std::strtoull(argv[index], nullptr, 10));
+    }
+    return fallback;
+}
+
+// 执行 fn 并返回耗时（纳秒）
+template <class F>
+inline double time_ns(F &&fn) {
+    auto t0 = std::chrono::steady_clock::now();
+    std::forward<F>(fn)();
+    auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(t1 - t0).count();
+}
+
+// 打印一行基准测试结果：名称、每次操作的纳秒数、每秒操作数
+inline void report(std::string_view name, std::size_t ops, double ns) {
+    std::cout << std::left << std::setw(40) << name << std::right
+              << std::setw(10) << std::fixed << std::setprecision(1)
+              << ns / static_cast<double>(std::max<std::size_t>(ops, 1))
+              << " ns/op" << std::setw(14) << std::setprecision(0)
+              << static_cast<double>(ops) * 1e9 / std::max(ns, 1.0)
+              << " op/s\n";
+}
+
+// 延迟分布：记录样本后按百分位打印，供唤醒延迟等对比使用
+struct LatencyHistogram {
+    std::vector<std::chrono::nanoseconds> samples;
+
+    void add(std::chrono::nanoseconds sample) {
+        samples.push_back(sample);
+    }
+
+    std::chrono::nanoseconds percentile(double p) {
+        if (samples.empty()) {
+            return {};
+        }
+        auto index = static_cast<std::size_t>(
+            p / 100 * static_cast<double>(samples.size() - 1));
+        std::nth_element(samples.begin(),
+                         samples.begin() + static_cast<std::ptrdiff_t>(index),
+                         samples.end());
+        return samples[index];
+    }
+
+    void print(std::string_view name) {
+        std::cout << name << ": n=" << samples.size();
+        for (double p: {50.0, 90.0, 99.0, 99.9, 100.0}) {
+            std::cout << " p" << p << '=' << percentile(p).count() << "ns";
+        }
+        std::cout << '\n';
+    }
+};
+} // namespace zh_async::test
@@ -0,0 +1,117 @@
+#include <std.hpp>
+#include <awaiter/task.hpp>
+#include <generic/generic_io.hpp>
+#include <generic/io_context.hpp>
+#include <generic/thread_pool.hpp>
+#include <platform/platform_io.hpp>
+#include "test_utils.hpp"
+
+/*
+    线程池的提交延迟和吞吐：
+    1. 外部线程连续 submitJob N 个空任务，统计提交本身的开销和全部执行完的吞吐
+    2. 逐个提交、等它执行完再提交下一个，统计从提交到开始执行的延迟分布（包含唤醒休眠线程的开销）
+    3. 协程里 co_await pool.run(...) 往返 M 次，统计经 IOContext::post 回到原线程的完整延迟
+    队列容量小于同时在途的任务数时，提交者会撞上队列全满，在线程池里休眠等空位
+    用法：thread_pool_bench [任务数] [往返次数] [工作线程数] [是否开启工作窃取] [队列容量]
+*/
+
+using namespace zh_async;
+
+static std::atomic<std::size_t> gDone{0};
+
+struct CountJob : ThreadPoolJob {
+    std::size_t mTotal = 0;
+
+    CountJob() : ThreadPoolJob{&CountJob::invoke} {}
+
+    static void invoke(ThreadPoolJob *job) noexcept {
+        auto self = static_cast<CountJob *>(job);
+        if (gDone.fetch_add(1, std::memory_order_acq_rel) + 1 == self->mTotal) {
+            gDone.notify_one();
+        }
+    }
+};
+
+struct StampJob : ThreadPoolJob {
+    std::chrono::steady_clock::time_point mSubmitted;
+    std::chrono::nanoseconds mLatency{};
+    std::atomic<bool> mFinished{false};
+
+    StampJob() : ThreadPoolJob{&StampJob::invoke} {}
+
+    static void invoke(ThreadPoolJob *job) noexcept {
+        auto self = static_cast<StampJob *>(job);
+        self->mLatency = std::chrono::steady_clock::now() - self->mSubmitted;
+        self->mFinished.store(true, std::memory_order_release);
+        self->mFinished.notify_one();
+    }
+};
+
+static void benchThroughput(Thread_pool &pool, std::size_t numJobs) {
+    auto jobs = std::make_unique<CountJob[]>(numJobs);
+    gDone.store(0);
+    double submitNs = 0;
+    double totalNs = test::time_ns([&] {
+        submitNs = test::time_ns([&] {
+            for (std::size_t i = 0; i < numJobs; ++i) {
+                jobs[i].mTotal = numJobs;
+                pool.submitJob(&jobs[i]);
+            }
+        });
+        for (std::size_t n; (n = gDone.load(std::memory_order_acquire)) != numJobs;) {
+            gDone.wait(n);
+        }
+    });
+    test::report("submitJob (submit only)", numJobs, submitNs);
+    test::report("submitJob (until all ran)", numJobs, totalNs);
+}
+
+static void benchLatency(Thread_pool &pool, std::size_t numJobs) {
+    test::LatencyHistogram histogram;
+    histogram.samples.reserve(numJobs);
+    for (std::size_t i = 0; i < numJobs; ++i) {
+        StampJob job;
+        job.mSubmitted = std::chrono::steady_clock::now();
+        pool.submitJob(&job);
+        job.mFinished.wait(false, std::memory_order_acquire);
+        histogram.add(job.mLatency);
+    }
+    histogram.print("submit -> start latency");
+}
+
+static Task<> roundTrips(Thread_pool &pool, std::size_t count,
+                         test::LatencyHistogram &histogram) {
+    for (std::size_t i = 0; i < count; ++i) {
+        auto t0 = std::chrono::steady_clock::now();
+        auto res = co_await pool.run([] {});
+        ZH_ASYNC_CHECK(!res.has_error());
+        histogram.add(std::chrono::steady_clock::now() - t0);
+    }
+}
+
+static void benchRoundTrip(Thread_pool &pool, std::size_t count) {
+    IOContext ctx;
+    test::LatencyHistogram histogram;
+    histogram.samples.reserve(count);
+    co_spawn(roundTrips(pool, count, histogram));
+    double ns = test::time_ns([&] { ctx.run(); });
+    ZH_ASYNC_CHECK(histogram.samples.size() == count);
+    test::report("co_await run() round trip", count, ns);
+    histogram.print("co_await run() round trip");
+}
+
+int main(int argc, char **argv) {
+    std::size_t numJobs = test::arg_or(argc, argv, 1, 1000000);
+    std::size_t numTrips = test::arg_or(argc, argv, 2, 100000);
+    std::size_t numWorkers = test::arg_or(argc, argv, 3, 0);
+    bool stealing = test::arg_or(argc, argv, 4, 0) != 0;
+    std::size_t queueSize = test::arg_or(argc, argv, 5, 1024);
+
+    Thread_pool pool(numWorkers, queueSize, stealing);
+    std::cout << "workers: " << pool.threads_count()
+              << (stealing ? ", work stealing\n" : "\n");
+    benchThroughput(pool, numJobs);
+    benchLatency(pool, std::min<std::size_t>(numJobs, 100000));
+    benchRoundTrip(pool, numTrips);
+    return 0;
+}
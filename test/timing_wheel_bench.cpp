@@ -0,0 +1,100 @@
+#include <std.hpp>
+#include <utils/timing_wheel.hpp>
+#include "test_utils.hpp"
+
+/*
+    大量计时器下时间轮与有序容器的对比：
+    插入 N 个到期时间随机分布在 [0, 10s) 的计时器，取消其中一半，再推进到最后一个到期点取出剩下的
+    有序容器用 std::multimap（同样是红黑树）代表按到期时间排序、反复取最早一个判断到期的做法
+    用法：timing_wheel_bench [计时器数]
+*/
+
+using namespace zh_async;
+using clock_type = std::chrono::steady_clock;
+
+struct WheelTimer : TimingWheel<WheelTimer>::NodeType {};
+
+static constexpr auto kHorizon = std::chrono::seconds(10);
+
+static std::vector<clock_type::duration> makeDelays(std::size_t n) {
+    std::mt19937_64 rng(1);
+    std::uniform_int_distribution<clock_type::rep> dist(
+        0, clock_type::duration(kHorizon).count() - 1);
+    std::vector<clock_type::duration> delays(n);
+    for (auto &delay: delays) {
+        delay = clock_type::duration(dist(rng));
+    }
+    return delays;
+}
+
+static void benchWheel(std::vector<clock_type::duration> const &delays) {
+    std::size_t n = delays.size();
+    auto wheel = std::make_unique<TimingWheel<WheelTimer>>(
+        std::chrono::milliseconds(1));
+    auto timers = std::make_unique<WheelTimer[]>(n);
+    auto base = clock_type::now();
+
+    double insertNs = test::time_ns([&] {
+        for (std::size_t i = 0; i < n; ++i) {
+            wheel->insert(timers[i], base + delays[i]);
+        }
+    });
+    double eraseNs = test::time_ns([&] {
+        for (std::size_t i = 0; i < n; i += 2) {
+            wheel->erase(timers[i]);
+        }
+    });
+    std::size_t expired = 0;
+    double expireNs = test::time_ns([&] {
+        wheel->advance(base + kHorizon + std::chrono::milliseconds(2));
+        while (wheel->pop_expired()) {
+            ++expired;
+        }
+    });
+    ZH_ASYNC_CHECK(expired == n / 2);
+    ZH_ASYNC_CHECK(wheel->empty());
+
+    test::report("wheel insert", n, insertNs);
+    test::report("wheel cancel", (n + 1) / 2, eraseNs);
+    test::report("wheel advance + pop", expired, expireNs);
+}
+
+static void benchTree(std::vector<clock_type::duration> const &delays) {
+    std::size_t n = delays.size();
+    std::multimap<clock_type::time_point, std::size_t> tree;
+    std::vector<decltype(tree)::iterator> timers(n);
+    auto base = clock_type::now();
+
+    double insertNs = test::time_ns([&] {
+        for (std::size_t i = 0; i < n; ++i) {
+            timers[i] = tree.emplace(base + delays[i], i);
+        }
+    });
+    double eraseNs = test::time_ns([&] {
+        for (std::size_t i = 0; i < n; i += 2) {
+            tree.erase(timers[i]);
+        }
+    });
+    std::size_t expired = 0;
+    double expireNs = test::time_ns([&] {
+        auto now = base + kHorizon;
+        while (!tree.empty() && tree.begin()->first <= now) {
+            tree.erase(tree.begin());
+            ++expired;
+        }
+    });
+    ZH_ASYNC_CHECK(expired == n / 2);
+    ZH_ASYNC_CHECK(tree.empty());
+
+    test::report("multimap insert", n, insertNs);
+    test::report("multimap cancel", (n + 1) / 2, eraseNs);
+    test::report("multimap pop front", expired, expireNs);
+}
+
+int main(int argc, char **argv) {
+    std::size_t n = test::arg_or(argc, argv, 1, 1000000);
+    auto delays = makeDelays(n);
+    benchWheel(delays);
+    benchTree(delays);
+    return 0;
+}
@@ -0,0 +1,209 @@
+#include <std.hpp>
+#include <utils/timing_wheel.hpp>
+#include "test_utils.hpp"
+
+/*
+    分层时间轮的正确性测试，重点是层间 cascade 和槽位回绕：
+    在 256、65536、2^24 等层边界两侧以及超出总跨度处放置计时器，
+    检查 advance 恰好在到期的 tick 取出每个节点（不提前、不推迟），
+    并检查沿着 next_expiry 一路推进时不会跳过任何到期点
+    tick 取 1 秒，测试本身不依赖真实时间的流逝
+*/
+
+using namespace zh_async;
+using Wheel = TimingWheel<struct TestTimer>;
+using clock_type = std::chrono::steady_clock;
+
+struct TestTimer : Wheel::NodeType {
+    std::uint64_t tick = 0;
+};
+
+static constexpr clock_type::duration kTick = std::chrono::seconds(1);
+
+// 构造时间轮之后取的基准时间：离轮的起点远小于半个 tick，
+// 因此 base + k * tick 落在第 k 个 tick 内，base + k * tick - tick / 2 向上取整正好是第 k 个 tick
+struct Harness {
+    Wheel wheel{kTick};
+    clock_type::time_point base = clock_type::now();
+    std::deque<TestTimer> timers;
+    std::uint64_t current = 0;
+
+    clock_type::time_point at(std::uint64_t tick) const {
+        return base + kTick * static_cast<clock_type::rep>(tick);
+    }
+
+    void add(std::uint64_t tick) {
+        auto &timer = timers.emplace_back();
+        timer.tick = tick;
+        wheel.insert(timer, at(tick) - kTick / 2);
+    }
+
+    // 推进到 tick，返回取出的节点，并检查每个都恰好在这个 tick 到期
+    std::size_t advanceTo(std::uint64_t tick) {
+        wheel.advance(at(tick));
+        current = tick;
+        std::size_t n = 0;
+        while (auto *timer = wheel.pop_expired()) {
+            ZH_ASYNC_CHECK(timer->tick == tick);
+            ++n;
+        }
+        return n;
+    }
+
+    std::size_t countAt(std::uint64_t tick) const {
+        return static_cast<std::size_t>(std::count_if(
+            timers.begin(), timers.end(),
+            [&](TestTimer const &timer) { return timer.tick == tick; }));
+    }
+
+    // 跳到每个到期点的前一个 tick 和到期点本身，前者不应取出任何节点
+    void checkEachExpiry() {
+        std::set<std::uint64_t> ticks;
+        for (auto &timer: timers) {
+            if (timer.tick > current) {
+                ticks.insert(timer.tick);
+            }
+        }
+        for (std::uint64_t tick: ticks) {
+            if (tick - 1 > current) {
+                ZH_ASYNC_CHECK(advanceTo(tick - 1) == 0);
+            }
+            ZH_ASYNC_CHECK(advanceTo(tick) == countAt(tick));
+        }
+        ZH_ASYNC_CHECK(wheel.empty());
+        ZH_ASYNC_CHECK(!wheel.next_expiry());
+    }
+
+    // 只按 next_expiry 推进：每一步都不能越过最早的到期点，且有限步内能取出它
+    void followNextExpiry() {
+        std::multiset<std::uint64_t> pending;
+        for (auto &timer: timers) {
+            if (timer.tick > current) {
+                pending.insert(timer.tick);
+            }
+        }
+        while (!pending.empty()) {
+            std::uint64_t earliest = *pending.begin();
+            std::size_t steps = 0;
+            while (current < earliest) {
+                auto next = wheel.next_expiry();
+                ZH_ASYNC_CHECK(next.has_value());
+                ZH_ASYNC_CHECK(*next > at(current));
+                ZH_ASYNC_CHECK(*next <= at(earliest));
+                // next_expiry 按轮的起点计算，比 base 早一点，向上取整回到对应的 tick
+                auto tick = static_cast<std::uint64_t>(
+                    (*next - base + kTick - clock_type::duration(1)) / kTick);
+                std::size_t n = advanceTo(tick);
+                ZH_ASYNC_CHECK(n == (tick == earliest ? pending.count(tick) : 0));
+                // 中间停下的点只能是某个节点的 cascade 点，每个节点每层最多一个
+                ZH_ASYNC_CHECK(++steps <= 4 * timers.size());
+            }
+            pending.erase(earliest);
+        }
+        ZH_ASYNC_CHECK(wheel.empty());
+    }
+};
+
+static std::vector<std::uint64_t> boundaryTicks(std::uint64_t from) {
+    std::vector<std::uint64_t> ticks;
+    for (std::uint64_t edge: {std::uint64_t(1) << 8, std::uint64_t(1) << 16,
+                              std::uint64_t(1) << 24}) {
+        for (std::uint64_t delta: {edge - 1, edge, edge + 1, 2 * edge - 1,
+                                   2 * edge, 3 * edge + 7}) {
+            ticks.push_back(from + delta);
+        }
+    }
+    ticks.push_back(from + 1);
+    // 第 0 层本轮（from 已经在最后一个槽位时是下一轮）的最后一个槽位
+    ticks.push_back((from | 0xff) == from ? from + 0x100 : (from | 0xff));
+    ticks.push_back((from | 0xffff) + 1); // 下一次第 1 层回绕
+    return ticks;
+}
+
+// 从 tick 0 开始，计时器分布在各层边界两侧
+static void testCascadeFromZero() {
+    Harness h;
+    for (auto tick: boundaryTicks(0)) {
+        h.add(tick);
+    }
+    h.checkEachExpiry();
+}
+
+// 先推进到一个不对齐的位置，再插入：槽位下标会在层内回绕
+static void testWrapAfterAdvance() {
+    for (std::uint64_t start: {std::uint64_t(300), std::uint64_t(65535),
+                               std::uint64_t(65536 + 200), std::uint64_t(0xfffff0)}) {
+        Harness h;
+        h.add(start);
+        ZH_ASYNC_CHECK(h.advanceTo(start) == 1);
+        h.timers.clear();
+        for (auto tick: boundaryTicks(start)) {
+            h.add(tick);
+        }
+        h.checkEachExpiry();
+    }
+}
+
+// 同样的分布只跟着 next_expiry 走
+static void testNextExpiryAcrossLevels() {
+    for (std::uint64_t start: {std::uint64_t(0), std::uint64_t(1000),
+                               std::uint64_t(65536 - 3)}) {
+        Harness h;
+        if (start) {
+            h.add(start);
+            ZH_ASYNC_CHECK(h.advanceTo(start) == 1);
+            h.timers.clear();
+        }
+        for (auto tick: boundaryTicks(start)) {
+            h.add(tick);
+        }
+        h.followNextExpiry();
+    }
+}
+
+// 超出 2^32 个 tick 的总跨度：先挂在最高层，轮到时按真实到期时间重新分配，不会提前
+static void testBeyondSpan() {
+    Harness h;
+    std::uint64_t span = std::uint64_t(1) << 32;
+    h.add(span + 5);
+    h.add(span - 1);
+    ZH_ASYNC_CHECK(h.advanceTo(span - 2) == 0);
+    ZH_ASYNC_CHECK(h.advanceTo(span - 1) == 1);
+    ZH_ASYNC_CHECK(h.advanceTo(span + 4) == 0);
+    ZH_ASYNC_CHECK(h.advanceTo(span + 5) == 1);
+    ZH_ASYNC_CHECK(h.wheel.empty());
+}
+
+// 随机插入和取消，与按到期时间排序的结果对照
+static void testRandomInsertErase() {
+    Harness h;
+    std::mt19937_64 rng(42);
+    for (int i = 0; i < 20000; ++i) {
+        int level = static_cast<int>(rng() % 4);
+        std::uint64_t range = std::uint64_t(1) << (8 * level + 8);
+        h.add(1 + rng() % range);
+    }
+    // 被取消的节点不应再被取出
+    std::map<std::uint64_t, std::size_t> expected;
+    for (auto &timer: h.timers) {
+        if (rng() % 3 == 0) {
+            h.wheel.erase(timer);
+        } else {
+            ++expected[timer.tick];
+        }
+    }
+    for (auto [tick, count]: expected) {
+        ZH_ASYNC_CHECK(h.advanceTo(tick) == count);
+    }
+    ZH_ASYNC_CHECK(h.wheel.empty());
+}
+
+int main() {
+    testCascadeFromZero();
+    testWrapAfterAdvance();
+    testNextExpiryAcrossLevels();
+    testBeyondSpan();
+    testRandomInsertErase();
+    std::cout << "timing_wheel_test: ok\n";
+    return 0;
+}
@@ -0,0 +1,292 @@
+#pragma once
+#include <std.hpp>
+#include <utils/cacheline.hpp>
+
+namespace zh_async {
+/*
+    无锁有界多生产者多消费者环形队列（Vyukov 序号槽算法）
+    每个槽位带一个序号：
+        序号 == 写位置       表示槽位空闲，生产者可以写入
+        序号 == 读位置 + 1   表示槽位已写入，消费者可以读取
+    生产者和消费者只在各自的位置计数器上做 CAS，不会互相阻塞
+    容量会向上取整到 2 的幂
+*/
+template <class T>
+struct ConcurrentRingQueue {
+private:
+    struct Slot {
+        std::atomic<std::size_t> mSeq;
+        T mValue;
+    };
+
+    std::unique_ptr<Slot[]> mSlots;
+    std::size_t mMask = 0;
+    // 读写位置分别独占缓存行，避免生产者与消费者之间的伪共享
+    alignas(hardware_destructive_interference_size) std::atomic<std::size_t> mHead{0};
+    alignas(hardware_destructive_interference_size) std::atomic<std::size_t> mTail{0};
+
+public:
+    explicit ConcurrentRingQueue(std::size_t maxSize = 0) {
+        set_max_size(maxSize);
+    }
+
+    ConcurrentRingQueue(ConcurrentRingQueue &&) = delete;
+
+    // 重置队列容量，仅能在没有其他线程访问时调用
+    void set_max_size(std::size_t maxSize) {
+        if (!maxSize) {
+            mSlots = nullptr;
+            mMask = 0;
+        } else {
+            maxSize = std::bit_ceil(maxSize);
+            mSlots = std::make_unique<Slot[]>(maxSize);
+            mMask = maxSize - 1;
+            for (std::size_t i = 0; i < maxSize; ++i) {
+                mSlots[i].mSeq.store(i, std::memory_order_relaxed);
+            }
+        }
+        mHead.store(0, std::memory_order_relaxed);
+        mTail.store(0, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] std::size_t max_size() const noexcept {
+        return mSlots ? mMask + 1 : 0;
+    }
+
+    // 并发下只是一个近似值
+    [[nodiscard]] std::size_t size() const noexcept {
+        std::size_t tail = mTail.load(std::memory_order_acquire);
+        std::size_t head = mHead.load(std::memory_order_acquire);
+        return tail > head ? tail - head : 0;
+    }
+
+    [[nodiscard]] bool empty() const noexcept {
+        return size() == 0;
+    }
+
+    [[nodiscard]] bool push(T &&value) {
+        if (!mSlots) [[unlikely]] {
+            return false;
+        }
+        std::size_t pos = mTail.load(std::memory_order_relaxed);
+        Slot *slot;
+        while (true) {
+            slot = &mSlots[pos & mMask];
+            std::size_t seq = slot->mSeq.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq) -
+                        static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0) {
+                if (mTail.compare_exchange_weak(pos, pos + 1,
+                                                std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false; // 队列已满
+            } else {
+                pos = mTail.load(std::memory_order_relaxed);
+            }
+        }
+        slot->mValue = std::move(value);
+        slot->mSeq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    [[nodiscard]] std::optional<T> pop() {
+        if (!mSlots) [[unlikely]] {
+            return std::nullopt;
+        }
+        std::size_t pos = mHead.load(std::memory_order_relaxed);
+        Slot *slot;
+        while (true) {
+            slot = &mSlots[pos & mMask];
+            std::size_t seq = slot->mSeq.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq) -
+                        static_cast<std::ptrdiff_t>(pos + 1);
+            if (diff == 0) {
+                if (mHead.compare_exchange_weak(pos, pos + 1,
+                                                std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return std::nullopt; // 队列为空
+            } else {
+                pos = mHead.load(std::memory_order_relaxed);
+            }
+        }
+        T value = std::move(slot->mValue);
+        slot->mSeq.store(pos + mMask + 1, std::memory_order_release);
+        return value;
+    }
+
+    /*
+        批量压入 values 开头的元素（移动走），返回压入的个数
+        先确认从写位置起连续空闲的槽位，再用一次 CAS 把它们全部占下，
+        之后逐个写入并发布序号；遇到尚未空出的槽位就只压入前面那几个
+    */
+    [[nodiscard]] std::size_t push_bulk(std::span<T> values) {
+        if (!mSlots || values.empty()) [[unlikely]] {
+            return 0;
+        }
+        std::size_t pos = mTail.load(std::memory_order_relaxed);
+        std::size_t count;
+        while (true) {
+            std::size_t seq = mSlots[pos & mMask].mSeq.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq) -
+                        static_cast<std::ptrdiff_t>(pos);
+            if (diff < 0) {
+                return 0; // 队列已满
+            }
+            if (diff > 0) {
+                pos = mTail.load(std::memory_order_relaxed);
+                continue;
+            }
+            count = 1;
+            while (count < values.size() && count <= mMask &&
+                   mSlots[(pos + count) & mMask].mSeq.load(
+                       std::memory_order_acquire) == pos + count) {
+                ++count;
+            }
+            if (mTail.compare_exchange_weak(pos, pos + count,
+                                            std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        for (std::size_t i = 0; i < count; ++i) {
+            Slot &slot = mSlots[(pos + i) & mMask];
+            slot.mValue = std::move(values[i]);
+            slot.mSeq.store(pos + i + 1, std::memory_order_release);
+        }
+        return count;
+    }
+
+    // 批量弹出最多 maxCount 个元素依次写入 out，返回弹出的个数，同样只需一次 CAS
+    template <class OutputIt>
+    [[nodiscard]] std::size_t pop_bulk(OutputIt out, std::size_t maxCount) {
+        if (!mSlots || maxCount == 0) [[unlikely]] {
+            return 0;
+        }
+        std::size_t pos = mHead.load(std::memory_order_relaxed);
+        std::size_t count;
+        while (true) {
+            std::size_t seq = mSlots[pos & mMask].mSeq.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq) -
+                        static_cast<std::ptrdiff_t>(pos + 1);
+            if (diff < 0) {
+                return 0; // 队列为空
+            }
+            if (diff > 0) {
+                pos = mHead.load(std::memory_order_relaxed);
+                continue;
+            }
+            count = 1;
+            while (count < maxCount && count <= mMask &&
+                   mSlots[(pos + count) & mMask].mSeq.load(
+                       std::memory_order_acquire) == pos + count + 1) {
+                ++count;
+            }
+            if (mHead.compare_exchange_weak(pos, pos + count,
+                                            std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        for (std::size_t i = 0; i < count; ++i) {
+            Slot &slot = mSlots[(pos + i) & mMask];
+            *out++ = std::move(slot.mValue);
+            slot.mSeq.store(pos + i + mMask + 1, std::memory_order_release);
+        }
+        return count;
+    }
+};
+
+/*
+    有界 Chase-Lev 工作窃取双端队列
+    所有者线程在底部 push/pop（后进先出，缓存友好），其他线程从顶部 steal（先进先出）
+    只有队列里剩最后一个元素时所有者才需要和窃取者竞争一次 CAS
+    元素按原子方式存取，因此 T 必须可平凡复制（例如 std::coroutine_handle<>）
+*/
+template <class T>
+struct WorkStealingDeque {
+    static_assert(std::is_trivially_copyable_v<T>);
+
+private:
+    std::unique_ptr<std::atomic<T>[]> mBuffer;
+    std::int64_t mMask = -1;
+    alignas(hardware_destructive_interference_size) std::atomic<std::int64_t> mTop{0};
+    alignas(hardware_destructive_interference_size) std::atomic<std::int64_t> mBottom{0};
+
+public:
+    explicit WorkStealingDeque(std::size_t maxSize = 0) {
+        set_max_size(maxSize);
+    }
+
+    WorkStealingDeque(WorkStealingDeque &&) = delete;
+
+    // 重置队列容量，仅能在没有其他线程访问时调用
+    void set_max_size(std::size_t maxSize) {
+        maxSize = maxSize ? std::bit_ceil(maxSize) : 0;
+        mBuffer = maxSize ? std::make_unique<std::atomic<T>[]>(maxSize) : nullptr;
+        mMask = static_cast<std::int64_t>(maxSize) - 1;
+        mTop.store(0, std::memory_order_relaxed);
+        mBottom.store(0, std::memory_order_relaxed);
+    }
+
+    // 并发下只是一个近似值
+    [[nodiscard]] std::size_t size() const noexcept {
+        std::int64_t b = mBottom.load(std::memory_order_relaxed);
+        std::int64_t t = mTop.load(std::memory_order_relaxed);
+        return b > t ? static_cast<std::size_t>(b - t) : 0;
+    }
+
+    // 仅所有者线程调用，队列满时返回 false
+    [[nodiscard]] bool push(T value) {
+        std::int64_t b = mBottom.load(std::memory_order_relaxed);
+        std::int64_t t = mTop.load(std::memory_order_acquire);
+        if (b - t > mMask) [[unlikely]] {
+            return false;
+        }
+        mBuffer[b & mMask].store(value, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        mBottom.store(b + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // 仅所有者线程调用
+    [[nodiscard]] std::optional<T> pop() {
+        std::int64_t b = mBottom.load(std::memory_order_relaxed) - 1;
+        mBottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        std::int64_t t = mTop.load(std::memory_order_relaxed);
+        if (t > b) {
+            mBottom.store(b + 1, std::memory_order_relaxed);
+            return std::nullopt;
+        }
+        T value = mBuffer[b & mMask].load(std::memory_order_relaxed);
+        if (t == b) {
+            // 最后一个元素，和窃取者抢
+            bool won = mTop.compare_exchange_strong(
+                t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            mBottom.store(b + 1, std::memory_order_relaxed);
+            if (!won) {
+                return std::nullopt;
+            }
+        }
+        return value;
+    }
+
+    // 任意线程调用，失败（为空或竞争失败）时返回 std::nullopt
+    [[nodiscard]] std::optional<T> steal() {
+        std::int64_t t = mTop.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        std::int64_t b = mBottom.load(std::memory_order_acquire);
+        if (t >= b) {
+            return std::nullopt;
+        }
+        T value = mBuffer[t & mMask].load(std::memory_order_relaxed);
+        if (!mTop.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                          std::memory_order_relaxed)) {
+            return std::nullopt;
+        }
+        return value;
+    }
+};
+} // namespace zh_async
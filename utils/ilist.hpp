@@ -88,7 +88,7 @@ namespace zh_async
 
         ListNode *doBack()const noexcept { return root.listPrev; }
 
-        bool doEmpty()const noexcept { return root.listNext == nullptr; }
+        bool doEmpty()const noexcept { return root.listNext == &root; }
 
         //删除首元节点
         ListNode* doPopFront() noexcept
@@ -141,7 +141,7 @@ namespace zh_async
 
         ListNode *doIterBegin()const noexcept { return root.listNext; }
 
-        ListNode *doIterEnd()const noexcept { return root.listPrev; }
+        ListNode *doIterEnd()const noexcept { return const_cast<ListNode *>(&root); }
 
         ListHead()noexcept : root() { root.listNext = root.listPrev = &root;}
 
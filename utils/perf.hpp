@@ -154,3 +154,182 @@ namespace zh_async {
 struct Perf {};
 } // namespace zh_async
 #endif
+
+#if ZH_ASYNC_FRAMESTAT
+# include <std.hpp>
+
+namespace zh_async {
+/*
+    协程帧分配统计（ZH_ASYNC_FRAMESTAT）
+    按协程函数所在位置记录帧大小、创建次数、总字节数和同时存活帧数的峰值，退出时按总字节数排序输出
+    帧大小在 promise 的 operator new 里连同帧地址一起记下，构造 promise 时按自己的帧地址取回，
+    地址对不上（帧分配被编译器省略，或记下的是别的协程帧）时记为 0，不会把上一次分配的大小算到这里
+    allocations() 是本线程累计创建的帧数，在一次请求前后各取一次相减即可知道这次请求创建了多少帧
+*/
+struct FrameStat {
+private:
+    struct Entry {
+        std::atomic<std::uint64_t> count{0};
+        std::atomic<std::uint64_t> bytes{0};
+        std::atomic<std::uint64_t> maxSize{0};
+        std::atomic<std::int64_t> live{0};
+        std::atomic<std::int64_t> peak{0};
+    };
+
+    struct PairLess {
+        bool operator()(std::pair<std::string_view, int> const &a,
+                        std::pair<std::string_view, int> const &b) const {
+            return std::tie(a.first, a.second) < std::tie(b.first, b.second);
+        }
+    };
+
+    struct FrameStatGather {
+        // 条目一经创建就不再销毁，退出时仍存活的协程帧析构时也能安全访问
+        std::map<std::pair<std::string_view, int>, Entry, PairLess> table;
+        std::mutex lock;
+
+        Entry &lookupLocked(char const *file, int line) {
+            std::lock_guard guard(lock);
+            return table[{file, line}];
+        }
+
+        /*
+            每构造一个协程帧都要找一次条目，先查线程局部的直接映射缓存，
+            同一个调用点只有第一次（或被其他调用点挤出缓存后）才加锁查表
+            file_name() 返回的是字符串字面量，同一调用点的地址不变，可以直接按地址比较
+        */
+        Entry &lookup(char const *file, int line) {
+            struct CacheSlot {
+                char const *file = nullptr;
+                int line = 0;
+                Entry *entry = nullptr;
+            };
+            static constexpr std::size_t kCacheSize = 256;
+            static thread_local CacheSlot cache[kCacheSize];
+            auto hash = reinterpret_cast<std::uintptr_t>(file) ^
+                        (static_cast<std::uintptr_t>(line) * 0x9e3779b1u);
+            CacheSlot &slot = cache[(hash ^ (hash >> 8)) % kCacheSize];
+            if (slot.file != file || slot.line != line) [[unlikely]] {
+                slot.entry = &lookupLocked(file, line);
+                slot.file = file;
+                slot.line = line;
+            }
+            return *slot.entry;
+        }
+
+        void dump() {
+            std::lock_guard guard(lock);
+            if (table.empty()) {
+                return;
+            }
+            auto b = [](std::uint64_t n) -> std::string {
+                if (n < 10240) {
+                    return std::format("{}B", n);
+                } else if (n < 10 * 1024 * 1024) {
+                    return std::format("{}K", n / 1024);
+                } else if (n < 10ull * 1024 * 1024 * 1024) {
+                    return std::format("{}M", n / (1024 * 1024));
+                } else {
+                    return std::format("{}G", n / (1024 * 1024 * 1024));
+                }
+            };
+            auto p = [](std::string_view s) -> std::string {
+                auto p = s.rfind('/');
+                if (p == std::string_view::npos) {
+                    return std::string(s);
+                } else {
+                    return std::string(s.substr(p + 1));
+                }
+            };
+            std::vector<std::pair<std::pair<std::string_view, int>, Entry *>>
+                sorted;
+            for (auto &[loc, e]: table) {
+                sorted.emplace_back(loc, &e);
+            }
+            std::sort(sorted.begin(), sorted.end(),
+                      [](auto const &lhs, auto const &rhs) {
+                          return lhs.second->bytes.load() >
+                                 rhs.second->bytes.load();
+                      });
+            std::size_t w = 0, nw = 1;
+            for (auto const &[loc, e]: sorted) {
+                w = std::max(w, p(loc.first).size());
+                nw = std::max(nw, std::to_string(e->count.load()).size());
+            }
+            std::string o;
+            auto oit = std::back_inserter(o);
+            std::format_to(oit, "{:>{}}:{:<4} {:^6} {:^6} {:^6} {:^6} {:^{}}\n",
+                           "file", w, "line", "avg", "max", "sum", "peak", "nr",
+                           nw + 1);
+            for (auto const &[loc, e]: sorted) {
+                std::uint64_t nr = e->count.load();
+                std::format_to(oit,
+                               "{:>{}}:{:<4} {:>6} {:>6} {:>6} {:>6} {:>{}}x\n",
+                               p(loc.first), w, loc.second,
+                               b(nr ? e->bytes.load() / nr : 0),
+                               b(e->maxSize.load()), b(e->bytes.load()),
+                               e->peak.load(), nr, nw);
+            }
+            fprintf(stderr, "%s", o.c_str());
+        }
+    };
+
+    struct FrameStatDumper {
+        FrameStatDumper &operator=(FrameStatDumper &&) = delete;
+
+        ~FrameStatDumper() {
+            gathered.dump();
+        }
+    };
+
+    static inline FrameStatGather &gathered = *new FrameStatGather;
+    static inline FrameStatDumper dumper;
+    static inline thread_local void *lastFrame = nullptr;
+    static inline thread_local std::size_t lastSize = 0;
+    static inline thread_local std::uint64_t numAllocated = 0;
+
+    template <class T>
+    static void atomicMax(std::atomic<T> &a, T v) noexcept {
+        T old = a.load(std::memory_order_relaxed);
+        while (old < v &&
+               !a.compare_exchange_weak(old, v, std::memory_order_relaxed)) {
+        }
+    }
+
+    Entry *entry;
+
+public:
+    // 由 promise 的 operator new 调用，frame 是刚分配的帧
+    static void onAllocate(void *frame, std::size_t size) noexcept {
+        lastFrame = frame;
+        lastSize = size;
+        ++numAllocated;
+    }
+
+    static std::uint64_t allocations() noexcept {
+        return numAllocated;
+    }
+
+    // frame 是所在 promise 的协程帧地址
+    FrameStat(void *frame,
+              std::source_location loc = std::source_location::current())
+        : entry(&gathered.lookup(loc.file_name(),
+                                 static_cast<int>(loc.line()))) {
+        std::uint64_t size = std::exchange(lastFrame, nullptr) == frame
+                                 ? std::exchange(lastSize, 0)
+                                 : 0;
+        entry->count.fetch_add(1, std::memory_order_relaxed);
+        entry->bytes.fetch_add(size, std::memory_order_relaxed);
+        atomicMax(entry->maxSize, size);
+        atomicMax(entry->peak,
+                  entry->live.fetch_add(1, std::memory_order_relaxed) + 1);
+    }
+
+    FrameStat(FrameStat &&) = delete;
+
+    ~FrameStat() {
+        entry->live.fetch_sub(1, std::memory_order_relaxed);
+    }
+};
+} // namespace zh_async
+#endif
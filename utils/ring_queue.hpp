@@ -40,7 +40,10 @@ struct RingQueue {
     }
 
     [[nodiscard]] bool full() const noexcept {
-        T *nextWrite = mWrite == mTail ? mHead.get() : mWrite + 1;
+        if (!mHead) {
+            return true;
+        }
+        T *nextWrite = next(mWrite);
         return nextWrite == mRead;// 如果下一个写入位置等于读取位置，则队列满
     }
 
@@ -49,18 +52,21 @@ struct RingQueue {
             return std::nullopt;
         }
         T p = std::move(*mRead);
-        mRead = mRead == mTail ? mHead.get() : mRead + 1;
+        mRead = next(mRead);
         return p;
     }
 
     [[nodiscard]] T pop_unchecked() {
         T p = std::move(*mRead);
-        mRead = mRead == mTail ? mHead.get() : mRead + 1;
+        mRead = next(mRead);
         return p;
     }
 
     [[nodiscard]] bool push(T &&value) {
-        T *nextWrite = mWrite == mTail ? mHead.get() : mWrite + 1;
+        if (!mHead) {
+            return false;
+        }
+        T *nextWrite = next(mWrite);
         if (nextWrite == mRead) {
             return false;
         }
@@ -70,9 +76,39 @@ struct RingQueue {
     }
 
     void push_unchecked(T &&value) {
-        T *nextWrite = mWrite == mTail ? mHead.get() : mWrite + 1;
         *mWrite = std::move(value);
-        mWrite = nextWrite;
+        mWrite = next(mWrite);
+    }
+
+    // 尽量多地压入 values 开头的元素（移动走），返回压入的个数
+    [[nodiscard]] std::size_t push_bulk(std::span<T> values) {
+        if (!mHead) {
+            return 0;
+        }
+        std::size_t count = std::min(values.size(), max_size() - 1 - size());
+        for (std::size_t i = 0; i < count; ++i) {
+            push_unchecked(std::move(values[i]));
+        }
+        return count;
+    }
+
+    // 最多弹出 maxCount 个元素依次写入 out，返回弹出的个数
+    template <class OutputIt>
+    [[nodiscard]] std::size_t pop_bulk(OutputIt out, std::size_t maxCount) {
+        if (empty()) {
+            return 0;
+        }
+        std::size_t count = std::min(maxCount, size());
+        for (std::size_t i = 0; i < count; ++i) {
+            *out++ = pop_unchecked();
+        }
+        return count;
+    }
+
+private:
+    // mTail 指向缓冲区末尾之后，走到这里时回绕到开头
+    T *next(T *p) const noexcept {
+        return p + 1 == mTail ? mHead.get() : p + 1;
     }
 };
 
@@ -3,18 +3,37 @@
 
 namespace zh_async 
 {
+    // 自旋等待时提示 CPU 降低功耗、让出流水线给同核的超线程
+    inline void cpu_relax() noexcept
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield");
+#endif
+    }
+
     //自旋锁
     struct SpinMutex
     {
         // 尝试获取锁。如果成功，则返回 true；如果锁已被其他线程占用，则返回 false。
         bool try_lock() { return !flag.test_and_set(std::memory_order_acquire); }
 
-        // 获取锁。如果锁已被其他线程占用，则循环等待，直到成功获取锁。
-        void lock() { while(flag.test_and_set(std::memory_order_acquire)); }
+        // 获取锁。如果锁已被其他线程占用，则只读地等到它看起来空闲再去抢，避免反复写同一缓存行
+        void lock()
+        {
+            while(flag.test_and_set(std::memory_order_acquire))
+            {
+                while(flag.test(std::memory_order_relaxed))
+                    cpu_relax();
+            }
+        }
+
+        void unlock() { flag.clear(std::memory_order_release); }
 
         // 用于自旋锁的原子标志，初始值为 false。
         // 原子标志是一个线程安全的布尔值，用于表示锁的状态。
         std::atomic_flag flag{false};
     };
 
-} 
\ No newline at end of file
+} 
@@ -0,0 +1,312 @@
+#pragma once
+#include <std.hpp>
+
+namespace zh_async {
+/*
+    分层时间轮（类似 Linux 早期的 timer wheel）
+    共 4 层，每层 256 个槽位，第 k 层一个槽位覆盖 256^k 个 tick，总跨度 2^32 个 tick
+    每个槽位是一个侵入式双向循环链表，插入和删除都是 O(1)，不需要比较
+    高层的节点在其所在槽位开始的那个 tick 被重新分配（cascade）到低层，最终从第 0 层到期
+    到期时间向上取整到 tick，因此计时器不会提前触发，最多推迟一个 tick
+    超出总跨度的节点先挂在最高层，轮到时再按真实到期时间重新分配
+    每层用位图记录非空槽位，推进时间和查询下一个到期点都可以跳过空槽
+*/
+template <class Value>
+struct TimingWheel {
+    using clock = std::chrono::steady_clock;
+
+private:
+    static constexpr std::size_t kLevels = 4;
+    static constexpr std::size_t kSlotBits = 8;
+    static constexpr std::size_t kSlots = std::size_t(1) << kSlotBits;
+    static constexpr std::size_t kSlotMask = kSlots - 1;
+    static constexpr std::size_t kWords = kSlots / 64;
+    static constexpr std::uint64_t kSpan = std::uint64_t(1)
+                                           << (kSlotBits * kLevels);
+    // 节点已到期、挂在待取出链表上时的层号
+    static constexpr std::uint8_t kExpiredLevel = kLevels;
+
+    struct WheelLink {
+        WheelLink() noexcept : wheelNext(this), wheelPrev(this) {}
+
+        WheelLink(WheelLink &&) = delete;
+
+        WheelLink *wheelNext;
+        WheelLink *wheelPrev;
+    };
+
+public:
+    struct NodeType : private WheelLink {
+        NodeType() = default;
+        NodeType(NodeType &&) = delete;
+
+        ~NodeType() noexcept {
+            erase_from_parent();
+        }
+
+        friend struct TimingWheel;
+
+    protected:
+        void erase_from_parent() noexcept {
+            static_assert(
+                std::is_base_of_v<NodeType, Value>,
+                "Value type must be derived from TimingWheel<Value>::NodeType");
+            if (this->wheel) {
+                this->wheel->doErase(this);
+            }
+        }
+
+    private:
+        TimingWheel *wheel = nullptr;
+        std::uint64_t wheelTick = 0;
+        std::uint8_t wheelLevel = 0;
+        std::uint8_t wheelSlot = 0;
+    };
+
+private:
+    clock::time_point mOrigin;
+    clock::duration mTick;
+    std::uint64_t mCurrent = 0; // 已经处理到的 tick
+    std::size_t mSize = 0;      // 仍在轮上（未到期）的节点数
+    WheelLink mSlots[kLevels][kSlots];
+    std::uint64_t mOccupied[kLevels][kWords]{};
+    WheelLink mExpired;
+
+    static void linkBefore(WheelLink *head, WheelLink *link) noexcept {
+        link->wheelNext = head;
+        link->wheelPrev = head->wheelPrev;
+        head->wheelPrev->wheelNext = link;
+        head->wheelPrev = link;
+    }
+
+    static void unlink(WheelLink *link) noexcept {
+        link->wheelPrev->wheelNext = link->wheelNext;
+        link->wheelNext->wheelPrev = link->wheelPrev;
+        link->wheelNext = link->wheelPrev = link;
+    }
+
+    // 把 from 链表上的节点整体挪到 to 链表（to 必须为空）
+    static void splice(WheelLink *from, WheelLink *to) noexcept {
+        if (from->wheelNext == from) {
+            return;
+        }
+        to->wheelNext = from->wheelNext;
+        to->wheelPrev = from->wheelPrev;
+        to->wheelNext->wheelPrev = to;
+        to->wheelPrev->wheelNext = to;
+        from->wheelNext = from->wheelPrev = from;
+    }
+
+    void markSlot(std::size_t level, std::size_t slot) noexcept {
+        mOccupied[level][slot >> 6] |= std::uint64_t(1) << (slot & 63);
+    }
+
+    void clearSlot(std::size_t level, std::size_t slot) noexcept {
+        mOccupied[level][slot >> 6] &= ~(std::uint64_t(1) << (slot & 63));
+    }
+
+    // 从 start（含）开始环形查找下一个非空槽位，返回相距的槽位数，整层为空时返回 -1
+    int scanSlots(std::size_t level, std::size_t start) const noexcept {
+        for (std::size_t i = 0; i <= kWords; ++i) {
+            std::size_t word = ((start >> 6) + i) % kWords;
+            std::uint64_t bits = mOccupied[level][word];
+            if (i == 0) {
+                bits &= ~std::uint64_t(0) << (start & 63);
+            } else if (i == kWords) {
+                bits &= (std::uint64_t(1) << (start & 63)) - 1;
+            }
+            if (bits) {
+                std::size_t slot = word * 64 + std::countr_zero(bits);
+                return static_cast<int>((slot - start) & kSlotMask);
+            }
+        }
+        return -1;
+    }
+
+    // 按节点相对当前 tick 的距离选择层和槽位
+    void place(NodeType *node) noexcept {
+        std::uint64_t tick = node->wheelTick;
+        if (tick - mCurrent >= kSpan) [[unlikely]] {
+            tick = mCurrent + kSpan - 1;
+        }
+        std::uint64_t delta = tick - mCurrent;
+        std::size_t level = 0;
+        while (level + 1 < kLevels && delta >= (std::uint64_t(1)
+                                                << (kSlotBits * (level + 1)))) {
+            ++level;
+        }
+        std::size_t slot = (tick >> (kSlotBits * level)) & kSlotMask;
+        node->wheelLevel = static_cast<std::uint8_t>(level);
+        node->wheelSlot = static_cast<std::uint8_t>(slot);
+        linkBefore(&mSlots[level][slot], node);
+        markSlot(level, slot);
+    }
+
+    // 把高层槽位里的节点重新分配到更低的层
+    void cascade(std::size_t level, std::size_t slot) noexcept {
+        WheelLink pending;
+        splice(&mSlots[level][slot], &pending);
+        clearSlot(level, slot);
+        while (pending.wheelNext != &pending) {
+            auto node = static_cast<NodeType *>(pending.wheelNext);
+            unlink(node);
+            place(node);
+        }
+    }
+
+    // 第 0 层的一个槽位到期，整体挪到待取出链表
+    void expire(std::size_t slot) noexcept {
+        WheelLink *head = &mSlots[0][slot];
+        while (head->wheelNext != head) {
+            auto node = static_cast<NodeType *>(head->wheelNext);
+            unlink(node);
+            node->wheelLevel = kExpiredLevel;
+            linkBefore(&mExpired, node);
+            --mSize;
+        }
+        clearSlot(0, slot);
+    }
+
+    void doErase(NodeType *node) noexcept {
+        unlink(node);
+        if (node->wheelLevel != kExpiredLevel) {
+            if (mSlots[node->wheelLevel][node->wheelSlot].wheelNext ==
+                &mSlots[node->wheelLevel][node->wheelSlot]) {
+                clearSlot(node->wheelLevel, node->wheelSlot);
+            }
+            --mSize;
+        }
+        node->wheel = nullptr;
+    }
+
+    // 向上取整，保证 tick 对应的时间点不早于 t
+    std::uint64_t ceilTick(clock::time_point t) const noexcept {
+        if (t <= mOrigin) {
+            return 0;
+        }
+        return static_cast<std::uint64_t>((t - mOrigin + mTick - clock::duration(1)) / mTick);
+    }
+
+    clock::time_point timeOf(std::uint64_t tick) const noexcept {
+        return mOrigin + mTick * static_cast<clock::rep>(tick);
+    }
+
+public:
+    explicit TimingWheel(clock::duration tick = std::chrono::milliseconds(1))
+        : mOrigin(clock::now()),
+          mTick(std::max(tick, clock::duration(1))) {}
+
+    TimingWheel(TimingWheel &&) = delete;
+
+    ~TimingWheel() noexcept {
+        for (auto &level: mSlots) {
+            for (auto &head: level) {
+                while (head.wheelNext != &head) {
+                    doErase(static_cast<NodeType *>(head.wheelNext));
+                }
+            }
+        }
+        while (mExpired.wheelNext != &mExpired) {
+            doErase(static_cast<NodeType *>(mExpired.wheelNext));
+        }
+    }
+
+    clock::duration tick() const noexcept {
+        return mTick;
+    }
+
+    void insert(Value &value, clock::time_point expires) noexcept {
+        NodeType *node = &static_cast<NodeType &>(value);
+        node->wheel = this;
+        // 已经过期的节点也放到下一个 tick，由下一次 advance 取出
+        node->wheelTick = std::max(ceilTick(expires), mCurrent + 1);
+        place(node);
+        ++mSize;
+    }
+
+    void erase(Value &value) noexcept {
+        doErase(&static_cast<NodeType &>(value));
+    }
+
+    [[nodiscard]] bool empty() const noexcept {
+        return mSize == 0 && mExpired.wheelNext == &mExpired;
+    }
+
+    // 推进到 now，把到期的节点挪到待取出链表，用 pop_expired 逐个取出
+    void advance(clock::time_point now) noexcept {
+        if (now < mOrigin) [[unlikely]] {
+            return;
+        }
+        std::uint64_t target =
+            static_cast<std::uint64_t>((now - mOrigin) / mTick);
+        while (mCurrent < target) {
+            if (mSize == 0) {
+                mCurrent = target;
+                break;
+            }
+            std::uint64_t next = mCurrent + 1;
+            std::size_t slot = next & kSlotMask;
+            if (slot != 0) {
+                // 跳过第 0 层本轮剩下的空槽位，最远跳到下一次需要 cascade 的地方
+                int steps = scanSlots(0, slot);
+                if (steps < 0 || slot + steps > kSlotMask) {
+                    next = (next | kSlotMask) + 1;
+                } else {
+                    next += steps;
+                }
+                if (next > target) {
+                    mCurrent = target;
+                    break;
+                }
+            }
+            mCurrent = next;
+            slot = mCurrent & kSlotMask;
+            if (slot == 0) {
+                for (std::size_t level = 1; level < kLevels; ++level) {
+                    std::size_t index =
+                        (mCurrent >> (kSlotBits * level)) & kSlotMask;
+                    cascade(level, index);
+                    if (index != 0) {
+                        break;
+                    }
+                }
+            }
+            expire(slot);
+        }
+    }
+
+    Value *pop_expired() noexcept {
+        if (mExpired.wheelNext == &mExpired) {
+            return nullptr;
+        }
+        auto node = static_cast<NodeType *>(mExpired.wheelNext);
+        unlink(node);
+        node->wheel = nullptr;
+        return static_cast<Value *>(node);
+    }
+
+    // 下一次需要处理的时间点：第 0 层是精确的到期 tick，高层是 cascade 的 tick（不晚于真实到期时间）
+    [[nodiscard]] std::optional<clock::time_point> next_expiry() const noexcept {
+        if (mExpired.wheelNext != &mExpired) {
+            return timeOf(mCurrent);
+        }
+        if (mSize == 0) {
+            return std::nullopt;
+        }
+        std::optional<std::uint64_t> earliest;
+        for (std::size_t level = 0; level < kLevels; ++level) {
+            std::size_t shift = kSlotBits * level;
+            std::size_t current = (mCurrent >> shift) & kSlotMask;
+            int steps = scanSlots(level, (current + 1) & kSlotMask);
+            if (steps < 0) {
+                continue;
+            }
+            std::uint64_t tick = ((mCurrent >> shift) + steps + 1) << shift;
+            if (!earliest || tick < *earliest) {
+                earliest = tick;
+            }
+        }
+        return timeOf(*earliest);
+    }
+};
+} // namespace zh_async